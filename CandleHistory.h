@@ -0,0 +1,47 @@
+#ifndef CANDLE_HISTORY_H
+#define CANDLE_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-capacity circular buffer keeping the newest N elements. It has no
+// heap storage, so a history of trivially copyable elements is itself
+// trivially copyable and a push never allocates or shifts elements.
+template <typename T, std::size_t N>
+class CandleHistory {
+    static_assert(N > 0, "history needs at least one element");
+
+  private:
+    T items[N];
+    uint32_t first = 0; // Index of the oldest element
+    uint32_t count = 0;
+
+  public:
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static constexpr std::size_t capacity() { return N; }
+
+    // Appends value, overwriting the oldest element once full
+    void push_back(const T& value) {
+        if (count < N) {
+            items[(first + count) % N] = value;
+            ++count;
+        } else {
+            items[first] = value;
+            first = (first + 1) % N;
+        }
+    }
+
+    // 0 is the oldest element, size() - 1 the newest
+    T& operator[](std::size_t index) { return items[(first + index) % N]; }
+    const T& operator[](std::size_t index) const {
+        return items[(first + index) % N];
+    }
+
+    T& back() { return (*this)[count - 1]; }
+    const T& back() const { return (*this)[count - 1]; }
+
+    void clear() { first = count = 0; }
+};
+
+#endif // CANDLE_HISTORY_H
@@ -0,0 +1,344 @@
+#ifndef HISTORY_LOADER_H
+#define HISTORY_LOADER_H
+
+#include "InstrumentRegistry.h"
+#include "SessionClock.h"
+#include "Types.h"
+#include "WorkStealingPool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Minute bars used to warm the candles up before the first live tick. A
+// directory holds one file per instrument, named after its token:
+//
+//   <token>.csv  time,open,high,low,close[,volume] per line, oldest first.
+//                time is epoch seconds or "YYYY-MM-DD HH:MM:SS" with an
+//                optional "T" separator and "+05:30" style offset (IST when
+//                absent), as Kite's historical API returns it. Lines that
+//                do not start with a digit, such as a header, are skipped.
+//   <token>.bin  A FileHeader followed by count Bars, oldest first.
+//
+// Files are memory mapped. CSV is parsed in place without copying lines;
+// binary bars are used straight from the mapping.
+namespace HistoryLoader {
+
+struct Bar {
+    int64_t start; // Epoch seconds
+    Price open, high, low, close;
+    int64_t volume;
+};
+static_assert(sizeof(Bar) == 32, "bar layout is part of the file format");
+
+constexpr char MAGIC[8] = { 'T', 'R', 'D', 'B', 'A', 'R', 'S', '\0' };
+constexpr uint32_t VERSION = 1;
+constexpr int64_t BAR_SECONDS = 60;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t barSize; // sizeof(Bar), guards against layout changes
+    uint64_t count;
+};
+
+// Read-only mapping of a whole file
+class MappedFile {
+  private:
+    int fd = -1;
+    const char* base = nullptr;
+    std::size_t length = 0;
+
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(fd, other.fd);
+        std::swap(base, other.base);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (base != nullptr) {
+            munmap(const_cast<char*>(base), length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool open(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+            return false;
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<const char*>(address);
+        madvise(const_cast<char*>(base), length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    const char* data() const { return base; }
+    std::size_t size() const { return length; }
+};
+
+namespace detail {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Reads up to width digits at p
+inline bool parseDigits(const char*& p, const char* end, int width, int64_t& value) {
+    value = 0;
+    int n = 0;
+    for (; p < end && n < width && isDigit(*p); ++p, ++n) {
+        value = value * 10 + (*p - '0');
+    }
+    return n > 0;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+constexpr int64_t daysFromCivil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+static_assert(daysFromCivil(2024, 1, 1) == 19723, "1 Jan 2024");
+
+// Epoch seconds, or a local date and time with an optional UTC offset
+inline bool parseTime(const char*& p, const char* end, int64_t& seconds) {
+    int64_t year;
+    if (!parseDigits(p, end, 10, year)) {
+        return false;
+    }
+    if (p == end || *p != '-') {
+        seconds = year;
+        return true;
+    }
+    int64_t month, day, hour, minute, second = 0;
+    ++p;
+    if (!parseDigits(p, end, 2, month) || p == end || *p++ != '-' ||
+        !parseDigits(p, end, 2, day) || p == end ||
+        (*p != ' ' && *p != 'T') || !parseDigits(++p, end, 2, hour) ||
+        p == end || *p++ != ':' || !parseDigits(p, end, 2, minute)) {
+        return false;
+    }
+    if (p < end && *p == ':') {
+        parseDigits(++p, end, 2, second);
+    }
+    int64_t offset = SessionClock::IST_OFFSET_SECONDS;
+    if (p < end && (*p == '+' || *p == '-')) {
+        const int64_t sign = (*p++ == '-') ? -1 : 1;
+        int64_t offsetHours, offsetMinutes = 0;
+        if (!parseDigits(p, end, 2, offsetHours)) {
+            return false;
+        }
+        if (p < end && *p == ':') {
+            ++p;
+        }
+        parseDigits(p, end, 2, offsetMinutes);
+        offset = sign * (offsetHours * 3600 + offsetMinutes * 60);
+    }
+    seconds = daysFromCivil(year, month, day) * SessionClock::DAY_SECONDS +
+              hour * 3600 + minute * 60 + second - offset;
+    return true;
+}
+
+// Rupees with any number of decimals to paise, rounded half up
+inline bool parsePrice(const char*& p, const char* end, Price& price) {
+    const char* digits = p;
+    int64_t paise = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        paise = paise * 10 + (*p - '0');
+    }
+    paise *= 100;
+    if (p < end && *p == '.') {
+        ++p;
+        if (p < end && isDigit(*p)) {
+            paise += (*p++ - '0') * 10;
+            if (p < end && isDigit(*p)) {
+                paise += *p++ - '0';
+                if (p < end && isDigit(*p)) {
+                    paise += (*p >= '5');
+                }
+            }
+        }
+        while (p < end && isDigit(*p)) {
+            ++p;
+        }
+    }
+    price = static_cast<Price>(paise);
+    return p != digits;
+}
+
+// Skips the field separator at p
+inline bool comma(const char*& p, const char* end) {
+    if (p < end && *p == ',') {
+        ++p;
+        return true;
+    }
+    return false;
+}
+
+} // namespace detail
+
+// Appends the bars of a CSV file's bytes to out. Returns false on a
+// malformed line.
+inline bool parseCsv(const char* p, const char* end, std::vector<Bar>& out) {
+    using namespace detail;
+    while (p < end) {
+        if (isDigit(*p)) {
+            Bar bar{};
+            if (!parseTime(p, end, bar.start) || !comma(p, end) ||
+                !parsePrice(p, end, bar.open) || !comma(p, end) ||
+                !parsePrice(p, end, bar.high) || !comma(p, end) ||
+                !parsePrice(p, end, bar.low) || !comma(p, end) ||
+                !parsePrice(p, end, bar.close)) {
+                return false;
+            }
+            if (comma(p, end)) {
+                parseDigits(p, end, 19, bar.volume);
+            }
+            out.push_back(bar);
+        }
+        // Rest of the line, usually just "\n" or "\r\n"
+        while (p < end && *p++ != '\n') {
+        }
+    }
+    return true;
+}
+
+// Bars of one instrument, either parsed from CSV into parsed or pointing
+// into the mapped binary file
+struct InstrumentHistory {
+    uint32_t token = 0;
+    uint32_t slot = InstrumentRegistry::INVALID_SLOT;
+    std::string path;
+    MappedFile file;
+    std::vector<Bar> parsed;
+    const Bar* bars = nullptr;
+    std::size_t count = 0;
+    bool ok = false;
+};
+
+// Maps and parses one file, keeping the bars that closed by now
+inline void load(InstrumentHistory& history, int64_t now) {
+    if (!history.file.open(history.path)) {
+        return;
+    }
+    const char* data = history.file.data();
+    const std::size_t size = history.file.size();
+    if (history.path.size() >= 4 &&
+        history.path.compare(history.path.size() - 4, 4, ".bin") == 0) {
+        FileHeader header;
+        if (size < sizeof(header)) {
+            return;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.version != VERSION || header.barSize != sizeof(Bar) ||
+            header.count > (size - sizeof(header)) / sizeof(Bar)) {
+            return;
+        }
+        history.bars = reinterpret_cast<const Bar*>(data + sizeof(header));
+        history.count = header.count;
+    } else {
+        // A minute bar line is about 50 bytes
+        history.parsed.reserve(size / 48);
+        if (!parseCsv(data, data + size, history.parsed)) {
+            return;
+        }
+        history.bars = history.parsed.data();
+        history.count = history.parsed.size();
+    }
+
+    // Bars must be in order; a bar still forming at now is left to the feed
+    for (std::size_t i = 0; i < history.count; ++i) {
+        if (i > 0 && history.bars[i].start <= history.bars[i - 1].start) {
+            return;
+        }
+        if (history.bars[i].start + BAR_SECONDS > now) {
+            history.count = i;
+            break;
+        }
+    }
+    history.ok = true;
+}
+
+// Registers every "<token>.csv" and "<token>.bin" in directory whose token
+// wanted(token) accepts and loads them on threads workers (0 = all cores); a
+// token with both files is loaded from the binary one. Must be called from
+// the thread that registers tokens. Files whose token is not wanted or
+// cannot be registered are skipped; ones that fail to load come back with
+// ok false.
+template <typename Wanted>
+std::vector<InstrumentHistory> loadDirectory(const std::string& directory,
+    int64_t now, Wanted&& wanted, std::size_t threads = 0) {
+    std::vector<InstrumentHistory> histories;
+    std::unordered_map<uint32_t, std::size_t> byToken;
+    std::error_code error;
+    for (const auto& entry :
+        std::filesystem::directory_iterator(directory, error)) {
+        const auto& path = entry.path();
+        const std::string stem = path.stem().string();
+        if (path.extension() != ".csv" && path.extension() != ".bin") {
+            continue;
+        }
+        if (stem.empty() || stem.size() > 10 ||
+            stem.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        auto token =
+            static_cast<uint32_t>(std::strtoul(stem.c_str(), nullptr, 10));
+        if (!wanted(token)) {
+            continue;
+        }
+        auto known = byToken.find(token);
+        if (known != byToken.end()) {
+            if (path.extension() == ".bin") {
+                histories[known->second].path = path.string();
+            }
+            continue;
+        }
+        uint32_t slot = InstrumentRegistry::getInstance().registerToken(token);
+        if (slot == InstrumentRegistry::INVALID_SLOT) {
+            continue;
+        }
+        byToken.emplace(token, histories.size());
+        histories.emplace_back();
+        histories.back().token = token;
+        histories.back().slot = slot;
+        histories.back().path = path.string();
+    }
+
+    WorkStealingPool pool(threads);
+    for (auto& history : histories) {
+        pool.submit([&history, now] { load(history, now); });
+    }
+    pool.run();
+    return histories;
+}
+
+} // namespace HistoryLoader
+
+#endif // HISTORY_LOADER_H
@@ -0,0 +1,214 @@
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+// Streaming indicators with O(1) update cost and fixed memory. Prices are in
+// paise like Price; none of the types allocate, so ScripData stays trivially
+// copyable with an IndicatorSet inside it.
+
+// Periods, in candles of the series the indicator is attached to
+#ifndef INDICATOR_EMA_FAST
+#define INDICATOR_EMA_FAST 9
+#endif
+#ifndef INDICATOR_EMA_SLOW
+#define INDICATOR_EMA_SLOW 21
+#endif
+#ifndef INDICATOR_ATR_PERIOD
+#define INDICATOR_ATR_PERIOD 14
+#endif
+#ifndef INDICATOR_RSI_PERIOD
+#define INDICATOR_RSI_PERIOD 14
+#endif
+#ifndef INDICATOR_VOLUME_WINDOW
+#define INDICATOR_VOLUME_WINDOW 20
+#endif
+
+// Exponential moving average, seeded with the simple average of the first N
+// values
+template <int N>
+struct Ema {
+    double value = 0;
+    uint32_t count = 0;
+
+    void update(double x) {
+        if (count < N) {
+            ++count;
+            value += (x - value) / count;
+        } else {
+            value += (x - value) * (2.0 / (N + 1));
+        }
+    }
+    bool ready() const { return count >= N; }
+};
+
+// Average true range with Wilder's smoothing
+template <int N>
+struct Atr {
+    double value = 0;
+    int32_t prevClose = 0;
+    uint32_t count = 0;
+
+    void update(int32_t high, int32_t low, int32_t close) {
+        double range = high - low;
+        if (count > 0) {
+            range = std::max({ range, std::abs(double(high) - prevClose),
+                std::abs(double(low) - prevClose) });
+        }
+        if (count < N) {
+            ++count;
+            value += (range - value) / count;
+        } else {
+            value += (range - value) / N;
+        }
+        prevClose = close;
+    }
+    bool ready() const { return count >= N; }
+};
+
+// Relative strength index with Wilder's smoothing
+template <int N>
+struct Rsi {
+    double avgGain = 0, avgLoss = 0;
+    int32_t prevClose = 0;
+    uint32_t count = 0; // Closes seen
+
+    void update(int32_t close) {
+        if (count > 0) {
+            const double change = double(close) - prevClose;
+            const double gain = std::max(change, 0.0);
+            const double loss = std::max(-change, 0.0);
+            if (count <= N) {
+                avgGain += (gain - avgGain) / count;
+                avgLoss += (loss - avgLoss) / count;
+            } else {
+                avgGain += (gain - avgGain) / N;
+                avgLoss += (loss - avgLoss) / N;
+            }
+        }
+        ++count;
+        prevClose = close;
+    }
+    bool ready() const { return count > N; }
+    double value() const {
+        if (avgLoss == 0) {
+            return (avgGain == 0) ? 50 : 100;
+        }
+        return 100 - 100 / (1 + avgGain / avgLoss);
+    }
+};
+
+// Sum of the last N values
+template <std::size_t N>
+struct RollingSum {
+    int64_t values[N] = {};
+    int64_t sum = 0;
+    uint32_t next = 0;
+    uint32_t count = 0;
+
+    void push(int64_t value) {
+        sum += value - values[next];
+        values[next] = value;
+        next = (next + 1) % N;
+        count += (count < N);
+    }
+    double mean() const { return count ? double(sum) / count : 0; }
+};
+
+// Per-instrument state updated on every tick: VWAP and volume of the
+// session and its opening range. Ticks carry the cumulative day volume, so
+// the volume of a tick is its increase over the previous one. The first
+// tick after start() or a warm start only sets that baseline, so the day's
+// volume before it is not counted as one trade at its price.
+struct SessionIndicators {
+    int64_t rangeEnd = 0;    // Opening range covers [session open, rangeEnd)
+    int64_t lastVolume = -1; // Cumulative day volume as of the last tick, -1
+                             // before the first
+    int64_t barVolume = 0;   // Traded in the forming finest bar
+    int64_t value = 0;       // Sum of price * volume, paise
+    int64_t volume = 0;
+    int32_t rangeHigh = 0, rangeLow = 0; // Empty while high < low
+
+    void start(int64_t sessionOpen, int64_t rangeSeconds) {
+        *this = {};
+        rangeEnd = sessionOpen + rangeSeconds;
+        rangeHigh = std::numeric_limits<int32_t>::min();
+        rangeLow = std::numeric_limits<int32_t>::max();
+    }
+
+    void onTick(int32_t price, int64_t cumulativeVolume, int64_t time) {
+        if (lastVolume < 0) {
+            lastVolume = cumulativeVolume;
+        } else if (cumulativeVolume > lastVolume) {
+            const int64_t traded = cumulativeVolume - lastVolume;
+            value += int64_t(price) * traded;
+            volume += traded;
+            barVolume += traded;
+            lastVolume = cumulativeVolume;
+        }
+        if (time < rangeEnd) {
+            rangeHigh = std::max(rangeHigh, price);
+            rangeLow = std::min(rangeLow, price);
+        }
+    }
+
+    // A whole historical bar, priced at its typical price
+    void onBar(int32_t high, int32_t low, int32_t close, int64_t traded,
+        int64_t start) {
+        const int64_t typical = (int64_t(high) + low + close) / 3;
+        value += typical * traded;
+        volume += traded;
+        barVolume += traded;
+        if (start < rangeEnd) {
+            rangeHigh = std::max(rangeHigh, high);
+            rangeLow = std::min(rangeLow, low);
+        }
+    }
+
+    int32_t vwap() const {
+        return volume ? static_cast<int32_t>(value / volume) : 0;
+    }
+};
+
+// Indicators of one candle series, updated once per closed candle, plus the
+// session values as of that close
+struct IndicatorSet {
+    Ema<INDICATOR_EMA_FAST> emaFast;
+    Ema<INDICATOR_EMA_SLOW> emaSlow;
+    Atr<INDICATOR_ATR_PERIOD> atr;
+    Rsi<INDICATOR_RSI_PERIOD> rsi;
+    RollingSum<INDICATOR_VOLUME_WINDOW> volume; // Candle volumes
+    int64_t formingVolume = 0; // Traded in the forming candle so far
+
+    int32_t vwap = 0; // 0 while no volume has traded
+    int32_t rangeHigh = 0, rangeLow = 0;
+    bool rangeReady = false; // The opening range is complete and not empty
+
+    void addVolume(int64_t traded) { formingVolume += traded; }
+
+    // Takes in a closed candle; returns the volume it traded
+    int64_t close(int32_t high, int32_t low, int32_t closePrice) {
+        emaFast.update(closePrice);
+        emaSlow.update(closePrice);
+        atr.update(high, low, closePrice);
+        rsi.update(closePrice);
+        const int64_t traded = formingVolume;
+        volume.push(traded);
+        formingVolume = 0;
+        return traded;
+    }
+
+    void setSession(const SessionIndicators& session, int64_t time) {
+        vwap = session.vwap();
+        rangeHigh = session.rangeHigh;
+        rangeLow = session.rangeLow;
+        rangeReady = time >= session.rangeEnd &&
+                     session.rangeHigh >= session.rangeLow;
+    }
+};
+
+#endif // INDICATORS_H
@@ -0,0 +1,344 @@
+#ifndef INSTRUMENT_MASTER_H
+#define INSTRUMENT_MASTER_H
+
+#include "HistoryLoader.h"
+#include "InstrumentRegistry.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One row of Kite's instrument dump, fixed width so a sorted array of them
+// can be used straight from a mapped file. Text fields are NUL terminated
+// and truncated to fit.
+struct Instrument {
+    enum Type : uint8_t { Equity, Future, Call, Put, Other };
+
+    uint32_t token;
+    uint32_t exchangeToken;
+    char symbol[32];   // tradingsymbol, e.g. "NIFTY24JAN21500CE"
+    char name[24];     // Underlying, e.g. "NIFTY"
+    Price strike;      // Paise, 0 when not an option
+    Price tickSize;    // Paise
+    int32_t lotSize;
+    int32_t expiryDay; // Days since 1970-01-01, 0 when none
+    char segment[11];  // e.g. "NFO-OPT", "INDICES"
+    Type type;
+    char exchange[4];  // e.g. "NSE", "NFO"
+};
+static_assert(sizeof(Instrument) == 96, "record layout is part of the index format");
+
+// Kite's instrument master, loaded from the CSV its /instruments endpoint
+// serves:
+//
+//   instrument_token,exchange_token,tradingsymbol,name,last_price,expiry,
+//   strike,tick_size,lot_size,instrument_type,segment,exchange
+//
+// The CSV is parsed once into Instrument records sorted by token and saved
+// as a binary index next to it ("<csv>.idx"); later loads map that index
+// as long as the CSV has not changed since. find() is a binary search over
+// the mapping; symbolOf() and ofSlot() go through a slot-indexed table, so
+// the per-candle lookup is O(1).
+//
+// load() and tokenOf() must be called before the feed starts. The mapping
+// is never released, so symbols may be handed to LOG_FAST as static text.
+class InstrumentMaster {
+  private:
+    static constexpr char MAGIC[8] = { 'T', 'R', 'D', 'I', 'N', 'S', 'T', 'R' };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t UNRESOLVED = 0;
+    static constexpr uint32_t UNKNOWN = UINT32_MAX;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize; // sizeof(Instrument)
+        uint64_t count;
+        int64_t sourceBytes; // Size and modification time of the CSV the
+        int64_t sourceMtime; // index was built from
+    };
+
+    HistoryLoader::MappedFile file;
+    const Instrument* records = nullptr;
+    std::size_t count = 0;
+    // Per registry slot: record index + 1, UNKNOWN when the master has no
+    // such token, UNRESOLVED until first asked. Racing resolvers store the
+    // same value.
+    std::vector<std::atomic<uint32_t>> bySlot;
+    // "EXCHANGE:SYMBOL" -> token, built by the first tokenOf()
+    std::unordered_map<std::string, uint32_t> bySymbol;
+
+    InstrumentMaster() : bySlot(InstrumentRegistry::MAX_INSTRUMENTS) {}
+
+    // Field at p as [begin, end), unquoted; p is left past its comma
+    static void field(const char*& p, const char* end, const char*& begin,
+        const char*& fieldEnd) {
+        if (p < end && *p == '"') {
+            begin = ++p;
+            while (p < end && *p != '"') {
+                ++p;
+            }
+            fieldEnd = p;
+            while (p < end && *p != ',' && *p != '\n') {
+                ++p;
+            }
+        } else {
+            begin = p;
+            while (p < end && *p != ',' && *p != '\n' && *p != '\r') {
+                ++p;
+            }
+            fieldEnd = p;
+            while (p < end && *p != ',' && *p != '\n') {
+                ++p;
+            }
+        }
+        if (p < end && *p == ',') {
+            ++p;
+        }
+    }
+
+    template <std::size_t N>
+    static void copyText(char (&out)[N], const char* begin, const char* end) {
+        const std::size_t length = std::min<std::size_t>(end - begin, N - 1);
+        std::memcpy(out, begin, length);
+        std::memset(out + length, 0, N - length);
+    }
+
+    static int64_t number(const char* begin, const char* end) {
+        int64_t value = 0;
+        HistoryLoader::detail::parseDigits(begin, end, 19, value);
+        return value;
+    }
+
+    static Price price(const char* begin, const char* end) {
+        Price value = 0;
+        HistoryLoader::detail::parsePrice(begin, end, value);
+        return value;
+    }
+
+    // "YYYY-MM-DD" as days since 1970-01-01, 0 when empty
+    static int32_t day(const char* begin, const char* end) {
+        using namespace HistoryLoader::detail;
+        int64_t year, month, dayOfMonth;
+        if (!parseDigits(begin, end, 4, year) || begin == end ||
+            *begin++ != '-' || !parseDigits(begin, end, 2, month) ||
+            begin == end || *begin++ != '-' ||
+            !parseDigits(begin, end, 2, dayOfMonth)) {
+            return 0;
+        }
+        return static_cast<int32_t>(daysFromCivil(year, month, dayOfMonth));
+    }
+
+    static Instrument::Type typeOf(const char* begin, const char* end) {
+        const std::string type(begin, end);
+        if (type == "EQ") {
+            return Instrument::Equity;
+        }
+        if (type == "FUT") {
+            return Instrument::Future;
+        }
+        if (type == "CE") {
+            return Instrument::Call;
+        }
+        if (type == "PE") {
+            return Instrument::Put;
+        }
+        return Instrument::Other;
+    }
+
+    // Appends a record per data line of the CSV's bytes
+    static void parseCsv(const char* p, const char* end, std::vector<Instrument>& out) {
+        const char *begin, *fieldEnd;
+        while (p < end) {
+            if (!HistoryLoader::detail::isDigit(*p)) {
+                // Header or blank line
+                while (p < end && *p++ != '\n') {
+                }
+                continue;
+            }
+            Instrument record{};
+            field(p, end, begin, fieldEnd);
+            record.token = static_cast<uint32_t>(number(begin, fieldEnd));
+            field(p, end, begin, fieldEnd);
+            record.exchangeToken = static_cast<uint32_t>(number(begin, fieldEnd));
+            field(p, end, begin, fieldEnd);
+            copyText(record.symbol, begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            copyText(record.name, begin, fieldEnd);
+            field(p, end, begin, fieldEnd); // last_price, stale by design
+            field(p, end, begin, fieldEnd);
+            record.expiryDay = day(begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            record.strike = price(begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            record.tickSize = price(begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            record.lotSize = static_cast<int32_t>(number(begin, fieldEnd));
+            field(p, end, begin, fieldEnd);
+            record.type = typeOf(begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            copyText(record.segment, begin, fieldEnd);
+            field(p, end, begin, fieldEnd);
+            copyText(record.exchange, begin, fieldEnd);
+            while (p < end && *p++ != '\n') {
+            }
+            if (record.token != 0) {
+                out.push_back(record);
+            }
+        }
+    }
+
+    // Writes header and records to path via a temporary file, so a reader
+    // never maps a half-written index
+    static bool writeIndex(const std::string& path, const FileHeader& header,
+        const std::vector<Instrument>& sorted) {
+        const std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        auto writeAll = [fd](const void* data, std::size_t bytes) {
+            const char* p = static_cast<const char*>(data);
+            while (bytes != 0) {
+                ssize_t written = ::write(fd, p, bytes);
+                if (written <= 0) {
+                    return false;
+                }
+                p += written;
+                bytes -= static_cast<std::size_t>(written);
+            }
+            return true;
+        };
+        bool ok = writeAll(&header, sizeof(header)) &&
+                  writeAll(sorted.data(), sorted.size() * sizeof(Instrument));
+        ok = (::close(fd) == 0) && ok;
+        return ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    bool mapIndex(const std::string& path, const struct stat& source) {
+        HistoryLoader::MappedFile index;
+        FileHeader header;
+        if (!index.open(path) || index.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, index.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.version != VERSION ||
+            header.recordSize != sizeof(Instrument) ||
+            header.count != (index.size() - sizeof(header)) / sizeof(Instrument) ||
+            header.sourceBytes != static_cast<int64_t>(source.st_size) ||
+            header.sourceMtime != static_cast<int64_t>(source.st_mtime)) {
+            return false;
+        }
+        file = std::move(index);
+        records = reinterpret_cast<const Instrument*>(file.data() + sizeof(header));
+        count = header.count;
+        return true;
+    }
+
+  public:
+    // Never unmapped before exit, see the class comment
+    static InstrumentMaster& getInstance() {
+        static InstrumentMaster* instance = new InstrumentMaster();
+        return *instance;
+    }
+
+    // Loads the instrument CSV at path, from its index when that is up to
+    // date and otherwise by parsing it and rebuilding the index. Returns
+    // false if neither can be read.
+    bool load(const std::string& path) {
+        struct stat source;
+        if (::stat(path.c_str(), &source) != 0) {
+            return false;
+        }
+        const std::string indexPath = path + ".idx";
+        if (mapIndex(indexPath, source)) {
+            return true;
+        }
+
+        HistoryLoader::MappedFile csv;
+        if (!csv.open(path)) {
+            return false;
+        }
+        std::vector<Instrument> parsed;
+        parsed.reserve(csv.size() / 80); // A row is about 80 bytes
+        parseCsv(csv.data(), csv.data() + csv.size(), parsed);
+        std::sort(parsed.begin(), parsed.end(),
+            [](const Instrument& a, const Instrument& b) { return a.token < b.token; });
+        parsed.erase(std::unique(parsed.begin(), parsed.end(),
+                         [](const Instrument& a, const Instrument& b) {
+                             return a.token == b.token;
+                         }),
+            parsed.end());
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.recordSize = sizeof(Instrument);
+        header.count = parsed.size();
+        header.sourceBytes = static_cast<int64_t>(source.st_size);
+        header.sourceMtime = static_cast<int64_t>(source.st_mtime);
+        return writeIndex(indexPath, header, parsed) &&
+               mapIndex(indexPath, source);
+    }
+
+    bool loaded() const { return records != nullptr; }
+    std::size_t size() const { return count; }
+
+    // Records sorted by token
+    const Instrument* begin() const { return records; }
+    const Instrument* end() const { return records + count; }
+
+    const Instrument* find(uint32_t token) const {
+        const Instrument* found = std::lower_bound(begin(), end(), token,
+            [](const Instrument& record, uint32_t value) {
+                return record.token < value;
+            });
+        return (found != end() && found->token == token) ? found : nullptr;
+    }
+
+    // Record of a registry slot, null when the master does not have it.
+    // Safe from any thread.
+    const Instrument* ofSlot(uint32_t slot) {
+        uint32_t index = bySlot[slot].load(std::memory_order_relaxed);
+        if (index == UNRESOLVED) {
+            const Instrument* record =
+                find(InstrumentRegistry::getInstance().tokenOf(slot));
+            index = (record == nullptr)
+                        ? UNKNOWN
+                        : static_cast<uint32_t>(record - records) + 1;
+            bySlot[slot].store(index, std::memory_order_relaxed);
+        }
+        return (index == UNKNOWN) ? nullptr : &records[index - 1];
+    }
+
+    // Trading symbol of a slot, "" when unknown
+    const char* symbolOf(uint32_t slot) {
+        const Instrument* record = ofSlot(slot);
+        return (record == nullptr) ? "" : record->symbol;
+    }
+
+    // Token of e.g. tokenOf("NSE", "NIFTY 50"), 0 when unknown
+    uint32_t tokenOf(const std::string& exchange, const std::string& symbol) {
+        if (bySymbol.empty()) {
+            bySymbol.reserve(count);
+            for (const Instrument& record : *this) {
+                bySymbol.emplace(std::string(record.exchange) + ":" + record.symbol,
+                    record.token);
+            }
+        }
+        auto found = bySymbol.find(exchange + ":" + symbol);
+        return (found == bySymbol.end()) ? 0 : found->second;
+    }
+};
+
+#endif // INSTRUMENT_MASTER_H
@@ -0,0 +1,96 @@
+#ifndef INSTRUMENT_REGISTRY_H
+#define INSTRUMENT_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Maps every instrument token to a dense slot in [0, MAX_INSTRUMENTS) once,
+// when it is subscribed. Per-instrument state is then kept in arrays indexed
+// by slot, so the tick path does a single integer hash lookup per tick.
+//
+// Tokens are registered and looked up on the ticker thread (or before the
+// feed starts). Other threads only receive slots from it and may call
+// tokenOf(), whose entry is written before the slot is first handed out.
+class InstrumentRegistry {
+  public:
+    static constexpr uint32_t MAX_INSTRUMENTS = 16384;
+    static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+  private:
+    static constexpr uint32_t TABLE_BITS = 15; // 2x MAX_INSTRUMENTS
+    static constexpr uint32_t TABLE_MASK = (1u << TABLE_BITS) - 1;
+
+    struct Entry {
+        uint32_t token; // 0 marks an empty entry, Kite never issues token 0
+        uint32_t slot;
+    };
+
+    std::vector<Entry> table;     // Open addressing, linear probing
+    std::vector<uint32_t> tokens; // slot -> token
+    std::vector<uint8_t> priceOnly; // slot -> 1 if only its price is wanted
+    std::atomic<uint32_t> count{ 0 };
+
+    InstrumentRegistry()
+        : table(TABLE_MASK + 1, Entry{ 0, INVALID_SLOT }),
+          tokens(MAX_INSTRUMENTS, 0),
+          priceOnly(MAX_INSTRUMENTS, 0) {} // Singleton pattern
+
+    static uint32_t hash(uint32_t token) {
+        return (token * 2654435769u) >> (32 - TABLE_BITS);
+    }
+
+  public:
+    static InstrumentRegistry& getInstance() {
+        static InstrumentRegistry instance;
+        return instance;
+    }
+
+    // Returns the token's slot, assigning the next free one on first use.
+    // INVALID_SLOT once the table is full.
+    uint32_t registerToken(uint32_t token) {
+        if (token == 0) {
+            return INVALID_SLOT;
+        }
+        for (uint32_t i = hash(token);; i = (i + 1) & TABLE_MASK) {
+            Entry& entry = table[i];
+            if (entry.token == token) {
+                return entry.slot;
+            }
+            if (entry.token == 0) {
+                uint32_t slot = count.load(std::memory_order_relaxed);
+                if (slot >= MAX_INSTRUMENTS) {
+                    return INVALID_SLOT;
+                }
+                tokens[slot] = token;
+                entry = { token, slot };
+                count.store(slot + 1, std::memory_order_release);
+                return slot;
+            }
+        }
+    }
+
+    uint32_t slotOf(uint32_t token) const {
+        for (uint32_t i = hash(token);; i = (i + 1) & TABLE_MASK) {
+            const Entry& entry = table[i];
+            if (entry.token == token) {
+                return entry.slot;
+            }
+            if (entry.token == 0) {
+                return INVALID_SLOT;
+            }
+        }
+    }
+
+    uint32_t tokenOf(uint32_t slot) const { return tokens[slot]; }
+
+    // Marks slot as an instrument traded, not traded on, e.g. an option
+    // contract: its ticks keep its last price for orders but build no
+    // candles or signals. Must be called before the feed starts.
+    void setPriceOnly(uint32_t slot) { priceOnly[slot] = 1; }
+    bool isPriceOnly(uint32_t slot) const { return priceOnly[slot] != 0; }
+
+    uint32_t size() const { return count.load(std::memory_order_acquire); }
+};
+
+#endif // INSTRUMENT_REGISTRY_H
@@ -0,0 +1,141 @@
+#ifndef KITE_ORDER_BACKEND_H
+#define KITE_ORDER_BACKEND_H
+
+#include "InstrumentMaster.h"
+#include "Logger.h"
+#include "OrderGateway.h"
+#include "Types.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct KiteOrderConfig {
+    std::string product = "MIS"; // Intraday
+    std::string orderType = "MARKET";
+    std::string variety = "regular";
+    std::string validity = "DAY";
+    std::string tag;
+    int64_t pollMillis = 1000; // Between order book reads while awaiting fills
+};
+
+// Places orders on Kite with kc::kite::placeOrder from the gateway's I/O
+// thread, so the REST round trip never runs on the tick path. Tokens are
+// turned into exchange and tradingsymbol through the InstrumentMaster;
+// orders for tokens it does not list are rejected. Fills are read from the
+// order book at most every pollMillis while accepted orders are open.
+//
+// Only a throttled request (HTTP 429) is retried; any other failure may
+// have reached the exchange, so it is reported as a reject rather than
+// risk a second order.
+class KiteOrderBackend : public OrderBackend {
+  public:
+    using Config = KiteOrderConfig;
+
+  private:
+    kc::kite& kite;
+    const InstrumentMaster& master;
+    Config config;
+    // Accepted orders by Kite order id, as reported once complete
+    std::unordered_map<std::string, OrderEvent> working;
+    int64_t lastPoll = 0; // Steady clock, nanoseconds
+
+    static uint64_t exchangeIdOf(const std::string& orderId) {
+        uint64_t id = 0;
+        for (char c : orderId) {
+            if (c >= '0' && c <= '9') {
+                id = id * 10 + uint64_t(c - '0');
+            }
+        }
+        return id;
+    }
+
+    Reply place(const OrderIntent& order) {
+        const Instrument* instrument = master.find(order.token);
+        if (instrument == nullptr) {
+            LOG_FAST(ERROR, "No instrument for order token ", order.token);
+            return { Result::Rejected, 0 };
+        }
+        kc::placeOrderParams params;
+        params.exchange = instrument->exchange;
+        params.symbol = instrument->symbol;
+        params.transactionType = (order.side == OrderIntent::Buy) ? "BUY" : "SELL";
+        params.quantity = order.quantity;
+        params.product = config.product;
+        params.orderType = config.orderType;
+        params.variety = config.variety;
+        params.validity = config.validity;
+        params.tag = config.tag;
+        if (config.orderType == "LIMIT") {
+            params.price = toRupees(order.price);
+        }
+        try {
+            const std::string orderId = kite.placeOrder(params);
+            working[orderId] = { OrderEvent::Fill, order.side, order.slot,
+                order.id, exchangeIdOf(orderId), 0, order.quantity,
+                order.attempts };
+            return { Result::Accepted, exchangeIdOf(orderId) };
+        } catch (kc::kiteppException& e) {
+            Logger::getInstance().log(Logger::ERROR, "Kite order ", order.id,
+                " for ", params.symbol, " failed: ", e.code(), " ", e.message());
+            return { (e.code() == 429) ? Result::Retry : Result::Rejected, 0 };
+        } catch (std::exception& e) {
+            Logger::getInstance().log(Logger::ERROR, "Kite order ", order.id,
+                " for ", params.symbol, " failed: ", e.what());
+            return { Result::Rejected, 0 };
+        }
+    }
+
+  public:
+    KiteOrderBackend(kc::kite& kite, const InstrumentMaster& master,
+        const Config& config = {})
+        : kite(kite), master(master), config(config) {}
+
+    void send(const OrderIntent* orders, std::size_t count,
+        Reply* replies) override {
+        for (std::size_t i = 0; i < count; ++i) {
+            replies[i] = place(orders[i]);
+        }
+    }
+
+    // Reports complete orders as fills at their average price and orders
+    // the exchange rejected or cancelled as rejects
+    void poll(std::vector<OrderEvent>& fills) override {
+        const int64_t now = Logger::steadyNanos();
+        if (working.empty() || now - lastPoll < config.pollMillis * 1000000) {
+            return;
+        }
+        lastPoll = now;
+        std::vector<kc::order> book;
+        try {
+            book = kite.orders();
+        } catch (std::exception& e) {
+            Logger::getInstance().log(
+                Logger::ERROR, "Could not read the Kite order book: ", e.what());
+            return;
+        }
+        for (const auto& entry : book) {
+            auto it = working.find(entry.orderID);
+            if (it == working.end()) {
+                continue;
+            }
+            OrderEvent event = it->second;
+            if (entry.status == "COMPLETE") {
+                event.fillPrice = toPrice(entry.averagePrice);
+                event.quantity = entry.filledQuantity;
+            } else if (entry.status == "REJECTED" || entry.status == "CANCELLED") {
+                Logger::getInstance().log(Logger::ERROR, "Kite order ",
+                    entry.orderID, " ", entry.status, ": ", entry.statusMessage);
+                event.type = OrderEvent::Reject;
+                event.exchangeId = 0;
+            } else {
+                continue;
+            }
+            fills.push_back(event);
+            working.erase(it);
+        }
+    }
+};
+
+#endif // KITE_ORDER_BACKEND_H
@@ -0,0 +1,262 @@
+#ifndef LATENCY_TELEMETRY_H
+#define LATENCY_TELEMETRY_H
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Points on the way from a tick batch to a trade at which latency is recorded
+enum class Stage : uint8_t {
+    FeedEnqueue,   // onTicks entry -> batch queued on the candle shards
+    QueueWait,     // batch queued -> batch dequeued by a shard
+    BarClose,      // Closing a finest bar, roll-ups and detection included
+    PatternDetect, // One PatternEngine pass over a timeframe
+    TickToSignal,  // onTicks entry -> pattern signal armed
+    OrderTick,     // One OrderManager::updateTickData call
+    TickToTrade,   // onTicks entry -> entry executed
+    OrderAck,      // OrderGateway::submit -> order accepted by the backend
+    Count
+};
+
+inline const char* stageName(Stage stage) {
+    static const char* const names[] = { "feed_enqueue", "queue_wait",
+        "bar_close", "pattern_detect", "tick_to_signal", "order_tick",
+        "tick_to_trade", "order_ack" };
+    return names[static_cast<std::size_t>(stage)];
+}
+
+// Log-linear histogram in the style of HdrHistogram: values are grouped by
+// power of two, each split into 32 linear sub-buckets, so every recorded
+// value is kept to within about 3% up to 2^40. Written by one thread with
+// plain relaxed stores; any thread may read a snapshot.
+class HdrHistogram {
+  public:
+    static constexpr int SUB_BITS = 6;
+    static constexpr int MAX_BITS = 40;
+    static constexpr uint32_t HALF = 1u << (SUB_BITS - 1);
+    static constexpr uint32_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * HALF + HALF;
+
+    static uint32_t indexOf(uint64_t value) {
+        if (value < (uint64_t(1) << SUB_BITS)) {
+            return static_cast<uint32_t>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        if (msb >= MAX_BITS) {
+            return BUCKETS - 1;
+        }
+        int shift = msb - (SUB_BITS - 1);
+        return static_cast<uint32_t>(shift * HALF + (value >> shift));
+    }
+
+    // Highest value that maps to index
+    static uint64_t valueAt(uint32_t index) {
+        if (index < 2 * HALF) {
+            return index;
+        }
+        uint32_t shift = index / HALF - 1;
+        uint64_t sub = index - shift * HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t value) {
+        auto& count = counts[indexOf(value)];
+        count.store(count.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
+
+    void addTo(std::vector<uint64_t>& totals) const {
+        for (uint32_t i = 0; i < BUCKETS; ++i) {
+            totals[i] += counts[i].load(std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+};
+
+// Always-on latency telemetry. Stages are timed with Logger::timestampTicks()
+// (the TSC on x86) into per-thread histograms, so recording is a clock read
+// and an uncontended store. A reporter thread merges them and logs
+// per-interval percentiles together with the tick rate and registered gauges
+// such as queue depth.
+class LatencyTelemetry {
+  private:
+    struct ThreadHistograms {
+        HdrHistogram stages[static_cast<std::size_t>(Stage::Count)];
+    };
+
+    std::vector<std::shared_ptr<ThreadHistograms>> threads;
+    std::vector<std::pair<std::string, std::function<uint64_t()>>> gauges;
+    std::mutex registryMutex;
+    std::atomic<uint64_t> tickCount{ 0 }; // Written by the ticker thread
+
+    // Reporter state
+    std::thread reporter;
+    std::mutex reporterMutex;
+    std::condition_variable reporterWake;
+    bool reporting = false;
+    std::vector<std::vector<uint64_t>> previous; // Totals at the last report
+    uint64_t previousTicks = 0;
+    int64_t calibrationTicks, calibrationNanos;
+
+    LatencyTelemetry()
+        : previous(static_cast<std::size_t>(Stage::Count),
+              std::vector<uint64_t>(HdrHistogram::BUCKETS, 0)),
+          calibrationTicks(Logger::timestampTicks()),
+          calibrationNanos(Logger::steadyNanos()) {} // Singleton pattern
+
+    ThreadHistograms& threadHistograms() {
+        thread_local ThreadHistograms* local = [this] {
+            auto histograms = std::make_shared<ThreadHistograms>();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            threads.push_back(histograms);
+            return histograms.get();
+        }();
+        return *local;
+    }
+
+  public:
+    static LatencyTelemetry& getInstance() {
+        static LatencyTelemetry instance;
+        return instance;
+    }
+
+    ~LatencyTelemetry() { stopReporter(); }
+
+    static int64_t now() { return Logger::timestampTicks(); }
+
+    // Records now() - startTicks against stage
+    void record(Stage stage, int64_t startTicks) {
+        int64_t elapsed = now() - startTicks;
+        threadHistograms().stages[static_cast<std::size_t>(stage)].record(
+            elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+    }
+
+    // Called by the ticker thread only
+    void countTicks(std::size_t ticks) {
+        tickCount.store(tickCount.load(std::memory_order_relaxed) + ticks,
+            std::memory_order_relaxed);
+    }
+
+    // Value logged with every report; replaces a gauge of the same name
+    void setGauge(const std::string& name, std::function<uint64_t()> read) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& gauge : gauges) {
+            if (gauge.first == name) {
+                gauge.second = std::move(read);
+                return;
+            }
+        }
+        gauges.emplace_back(name, std::move(read));
+    }
+
+    void startReporter(std::chrono::seconds interval) {
+        std::lock_guard<std::mutex> lock(reporterMutex);
+        if (reporting || interval.count() <= 0) {
+            return;
+        }
+        reporting = true;
+        reporter = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(reporterMutex);
+            while (!reporterWake.wait_for(
+                lock, interval, [this] { return !reporting; })) {
+                report(interval);
+            }
+        });
+    }
+
+    void stopReporter() {
+        {
+            std::lock_guard<std::mutex> lock(reporterMutex);
+            if (!reporting) {
+                return;
+            }
+            reporting = false;
+        }
+        reporterWake.notify_all();
+        reporter.join();
+    }
+
+    // Logs every stage recorded since the previous report
+    void report(std::chrono::seconds interval) {
+        const int64_t ticksNow = now(), nanosNow = Logger::steadyNanos();
+        const double nanosPerTick =
+            (ticksNow > calibrationTicks)
+                ? double(nanosNow - calibrationNanos) / (ticksNow - calibrationTicks)
+                : 1.0;
+        auto micros = [nanosPerTick](uint64_t ticks) {
+            return ticks * nanosPerTick / 1000.0;
+        };
+
+        std::vector<std::vector<uint64_t>> totals(
+            static_cast<std::size_t>(Stage::Count),
+            std::vector<uint64_t>(HdrHistogram::BUCKETS, 0));
+        std::vector<std::pair<std::string, uint64_t>> gaugeValues;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (const auto& thread : threads) {
+                for (std::size_t s = 0; s < totals.size(); ++s) {
+                    thread->stages[s].addTo(totals[s]);
+                }
+            }
+            for (const auto& gauge : gauges) {
+                gaugeValues.emplace_back(gauge.first, gauge.second());
+            }
+        }
+
+        uint64_t ticks = tickCount.load(std::memory_order_relaxed);
+        Logger::getInstance().log(Logger::DEBUG, "Latency: ",
+            (ticks - previousTicks) / std::max<int64_t>(1, interval.count()),
+            " ticks/s", [&] {
+                std::string text;
+                for (const auto& gauge : gaugeValues) {
+                    text += ", " + gauge.first + " " + std::to_string(gauge.second);
+                }
+                return text;
+            }());
+        previousTicks = ticks;
+
+        for (std::size_t s = 0; s < totals.size(); ++s) {
+            std::vector<uint64_t> delta(HdrHistogram::BUCKETS);
+            uint64_t count = 0;
+            for (uint32_t i = 0; i < HdrHistogram::BUCKETS; ++i) {
+                delta[i] = totals[s][i] - previous[s][i];
+                count += delta[i];
+            }
+            previous[s] = std::move(totals[s]);
+            if (count == 0) {
+                continue;
+            }
+
+            // Values at the 50th, 99th and 99.9th percentile and the max
+            const double ranks[] = { 0.5, 0.99, 0.999, 1.0 };
+            double values[4] = {};
+            uint64_t seen = 0;
+            std::size_t next = 0;
+            for (uint32_t i = 0; i < HdrHistogram::BUCKETS && next < 4; ++i) {
+                seen += delta[i];
+                while (next < 4 && delta[i] != 0 &&
+                       seen >= static_cast<uint64_t>(ranks[next] * count + 0.5)) {
+                    values[next++] = micros(HdrHistogram::valueAt(i));
+                }
+            }
+            Logger::getInstance().log(Logger::DEBUG, "Latency ",
+                stageName(static_cast<Stage>(s)), ": n=", count, " p50 ",
+                values[0], "us p99 ", values[1], "us p99.9 ", values[2],
+                "us max ", values[3], "us");
+        }
+    }
+};
+
+#endif // LATENCY_TELEMETRY_H
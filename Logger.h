@@ -11,6 +11,154 @@
 #include <thread>
 #include <condition_variable>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Compile-time floor for LOG_FAST, calls below it generate no code at all.
+// Uses the Logger::LogLevel order: 0 = INFO, 1 = DEBUG, 2 = ERROR.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// Hot-path logging: LOG_FAST(DEBUG, "price ", price). Arguments are copied as
+// raw bytes and formatted later by the logging thread, see Logger::logFast.
+#define LOG_FAST(level, ...)                                                   \
+    do {                                                                       \
+        if constexpr (Logger::level >= LOG_MIN_LEVEL) {                        \
+            Logger::getInstance().logFast(Logger::level, __VA_ARGS__);         \
+        }                                                                      \
+    } while (0)
+
+namespace logdetail {
+
+// Every deferred record starts with the function that knows how to format
+// its payload. One instantiation exists per argument type list, so the
+// pointer doubles as the record's format id.
+using DecodeFn = const char* (*)(const char* payload, std::ostream& out);
+
+struct RecordHeader {
+    DecodeFn decode; // nullptr marks padding up to the end of the buffer
+    int64_t timestamp; // Logger::timestampTicks()
+    uint32_t size;     // Payload bytes following the header
+    uint8_t level;
+};
+
+// How one argument type is stored in a record. Numbers and enums are copied
+// as is; std::string is copied as length plus bytes; const char* is stored as
+// the pointer, so it must point at a string literal or other static text.
+template <typename T>
+struct Arg {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+        "LOG_FAST takes numbers, enums, string literals and std::string");
+    static std::size_t size(const T&) { return sizeof(T); }
+    static char* encode(char* out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+    static const char* decode(const char* in, std::ostream& out) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        if constexpr (std::is_enum<T>::value) {
+            out << static_cast<std::underlying_type_t<T>>(value);
+        } else {
+            out << value;
+        }
+        return in + sizeof(T);
+    }
+};
+
+template <>
+struct Arg<const char*> {
+    static std::size_t size(const char*) { return sizeof(const char*); }
+    static char* encode(char* out, const char* value) {
+        std::memcpy(out, &value, sizeof(value));
+        return out + sizeof(value);
+    }
+    static const char* decode(const char* in, std::ostream& out) {
+        const char* value;
+        std::memcpy(&value, in, sizeof(value));
+        out << value;
+        return in + sizeof(value);
+    }
+};
+
+template <>
+struct Arg<char*> : Arg<const char*> {};
+
+template <>
+struct Arg<std::string> {
+    static std::size_t size(const std::string& value) {
+        return sizeof(uint32_t) + value.size();
+    }
+    static char* encode(char* out, const std::string& value) {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + sizeof(length), value.data(), length);
+        return out + sizeof(length) + length;
+    }
+    static const char* decode(const char* in, std::ostream& out) {
+        uint32_t length;
+        std::memcpy(&length, in, sizeof(length));
+        out.write(in + sizeof(length), length);
+        return in + sizeof(length) + length;
+    }
+};
+
+template <typename... Args>
+const char* decodeRecord(const char* payload, std::ostream& out) {
+    ((payload = Arg<Args>::decode(payload, out)), ...);
+    return payload;
+}
+
+// Byte ring written by one application thread and read by the logging
+// thread. Positions only ever grow; records never wrap around the end.
+struct ThreadBuffer {
+    static constexpr std::size_t CAPACITY = 1 << 20;
+
+    alignas(64) std::atomic<std::size_t> tail{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    alignas(64) std::atomic<std::size_t> head{ 0 };
+    std::atomic<bool> retired{ false }; // Owning thread has exited
+    std::unique_ptr<char[]> data{ new char[CAPACITY] };
+
+    static constexpr std::size_t align(std::size_t bytes) {
+        return (bytes + 7) & ~std::size_t(7);
+    }
+
+    // Space for bytes contiguous bytes, or nullptr if the ring is full
+    char* reserve(std::size_t bytes) {
+        bytes = align(bytes);
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t offset = t & (CAPACITY - 1);
+        std::size_t padding = (offset + bytes > CAPACITY) ? CAPACITY - offset : 0;
+        if (t + padding + bytes - head.load(std::memory_order_acquire) > CAPACITY) {
+            return nullptr;
+        }
+        if (padding) {
+            DecodeFn marker = nullptr;
+            std::memcpy(data.get() + offset, &marker, sizeof(marker));
+            tail.store(t + padding, std::memory_order_release);
+            return data.get();
+        }
+        return data.get() + offset;
+    }
+
+    void commit(std::size_t bytes) {
+        tail.store(tail.load(std::memory_order_relaxed) + align(bytes),
+            std::memory_order_release);
+    }
+};
+
+} // namespace logdetail
 
 class Logger {
 public:
@@ -27,9 +175,21 @@ public:
     template <typename... Args>
     void log(LogLevel level, Args... args);
 
+    // Deferred variant for the tick and candle threads, use via LOG_FAST.
+    // Only the timestamp and argument bytes are written to a lock-free
+    // per-thread buffer; formatting happens on the logging thread.
+    template <typename... Args>
+    void logFast(LogLevel level, const Args&... args);
+
     // Destructor to gracefully shut down the logging thread
     ~Logger();
 
+    static int64_t steadyNanos();
+
+    // TSC where available (cheaper than a clock call), else steady nanos.
+    // Also the clock of LatencyTelemetry.
+    static int64_t timestampTicks();
+
 private:
     // Private constructor for singleton
     Logger();
@@ -37,6 +197,12 @@ private:
     // Method for the logging thread to process log entries
     void processLogs();
 
+    // Decode and write every pending deferred record, oldest first
+    void drainThreadBuffers();
+
+    // Buffer of the calling thread, registered on first use
+    logdetail::ThreadBuffer& threadBuffer();
+
     // Convert different types of arguments to string
     template <typename T>
     std::string toString(const T& value);
@@ -53,6 +219,15 @@ private:
     std::thread logThread;
     LogLevel logLevelThreshold;  // The log level threshold
 
+    std::vector<std::shared_ptr<logdetail::ThreadBuffer>> threadBuffers;
+    std::mutex buffersMutex;
+    std::vector<std::pair<int64_t, std::string>> pendingRecords;
+    // Wall clock at steady_clock zero, to stamp deferred records
+    std::chrono::system_clock::time_point steadyEpoch;
+    // Reference point to convert record ticks into steady nanoseconds
+    int64_t startTicks;
+    int64_t startNanos;
+
     // Constants
     const int BUFFER_FLUSH_LIMIT = 10;  // Max number of logs before flush
 };
@@ -64,6 +239,11 @@ inline Logger& Logger::getInstance() {
 }
 
 inline Logger::Logger() : isRunning(true), logLevelThreshold(DEBUG) {  // Default level is DEBUG
+    startTicks = timestampTicks();
+    startNanos = steadyNanos();
+    steadyEpoch = std::chrono::system_clock::now() -
+                  std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                      std::chrono::nanoseconds(startNanos));
     logFile.open("trade_data.log", std::ios::out | std::ios::app);
     logThread = std::thread(&Logger::processLogs, this);
 }
@@ -109,6 +289,63 @@ inline void Logger::log(LogLevel level, Args... args) {
     }
 }
 
+template <typename... Args>
+inline void Logger::logFast(LogLevel level, const Args&... args) {
+    using namespace logdetail;
+    if (level < logLevelThreshold) {
+        return;
+    }
+    const std::size_t payload =
+        (std::size_t(0) + ... + Arg<std::decay_t<Args>>::size(args));
+    ThreadBuffer& buffer = threadBuffer();
+    char* out = buffer.reserve(sizeof(RecordHeader) + payload);
+    if (out == nullptr) {
+        buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return;
+    }
+    RecordHeader header{ &decodeRecord<std::decay_t<Args>...>, timestampTicks(),
+        static_cast<uint32_t>(payload), static_cast<uint8_t>(level) };
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    ((out = Arg<std::decay_t<Args>>::encode(out, args)), ...);
+    buffer.commit(sizeof(RecordHeader) + payload);
+}
+
+inline int64_t Logger::steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline int64_t Logger::timestampTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<int64_t>(__rdtsc());
+#else
+    return steadyNanos();
+#endif
+}
+
+inline logdetail::ThreadBuffer& Logger::threadBuffer() {
+    // Marks the buffer retired when its thread exits, so the logging thread
+    // can drop it once drained
+    struct Holder {
+        std::shared_ptr<logdetail::ThreadBuffer> buffer;
+        ~Holder() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    static thread_local Holder holder;
+    if (!holder.buffer) {
+        holder.buffer = std::make_shared<logdetail::ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        threadBuffers.push_back(holder.buffer);
+    }
+    return *holder.buffer;
+}
+
 template <typename T>
 inline std::string Logger::toString(const T& value) {
     std::stringstream ss;
@@ -125,16 +362,100 @@ inline std::string Logger::logLevelToString(LogLevel level) {
     }
 }
 
+inline void Logger::drainThreadBuffers() {
+    using namespace logdetail;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers = threadBuffers;
+    }
+
+    // Calibrate ticks against the steady clock over the logger's lifetime
+    const int64_t nowTicks = timestampTicks();
+    const int64_t nowNanos = steadyNanos();
+    const double nanosPerTick = (nowTicks > startTicks)
+                                    ? double(nowNanos - startNanos) / (nowTicks - startTicks)
+                                    : 1.0;
+
+    std::ostringstream line;
+    for (auto& buffer : buffers) {
+        std::size_t head = buffer->head.load(std::memory_order_relaxed);
+        const std::size_t tail = buffer->tail.load(std::memory_order_acquire);
+        while (head != tail) {
+            const char* record =
+                buffer->data.get() + (head & (ThreadBuffer::CAPACITY - 1));
+            RecordHeader header;
+            std::memcpy(&header, record, sizeof(header.decode));
+            if (header.decode == nullptr) {
+                head += ThreadBuffer::CAPACITY - (head & (ThreadBuffer::CAPACITY - 1));
+                continue;
+            }
+            std::memcpy(&header, record, sizeof(header));
+
+            int64_t nanos = startNanos +
+                            static_cast<int64_t>((header.timestamp - startTicks) * nanosPerTick);
+            auto wall = steadyEpoch +
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::nanoseconds(nanos));
+            std::time_t wall_time = std::chrono::system_clock::to_time_t(wall);
+            std::tm local_time;
+            localtime_r(&wall_time, &local_time);
+
+            line.str(std::string());
+            line << "[" << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S") << "] ";
+            line << "[" << logLevelToString(static_cast<LogLevel>(header.level)) << "] ";
+            header.decode(record + sizeof(header), line);
+            line << "\n";
+            pendingRecords.emplace_back(header.timestamp, line.str());
+
+            head += ThreadBuffer::align(sizeof(header) + header.size);
+        }
+        buffer->head.store(head, std::memory_order_release);
+    }
+
+    // Interleave the threads' records in the order they were logged
+    std::stable_sort(pendingRecords.begin(), pendingRecords.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& record : pendingRecords) {
+        logFile << record.second;
+    }
+    pendingRecords.clear();
+
+    for (auto& buffer : buffers) {
+        uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+            logFile << "[ERROR] " << dropped << " log records dropped, buffer full\n";
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    threadBuffers.erase(
+        std::remove_if(threadBuffers.begin(), threadBuffers.end(),
+            [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                return buffer->retired.load(std::memory_order_acquire) &&
+                       buffer->head.load(std::memory_order_relaxed) ==
+                           buffer->tail.load(std::memory_order_acquire);
+            }),
+        threadBuffers.end());
+}
+
 // Background logging thread function
 inline void Logger::processLogs() {
-    while (isRunning) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        logCondition.wait_for(lock, std::chrono::seconds(2), [this]() { return !logQueue.empty() || !isRunning; });
+    bool running = true;
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            // Deferred records are polled, the hot path never signals
+            logCondition.wait_for(lock, std::chrono::milliseconds(5),
+                [this]() { return !logQueue.empty() || !isRunning; });
+            running = isRunning;
 
-        while (!logQueue.empty()) {
-            logFile << logQueue.front();
-            logQueue.pop();
+            while (!logQueue.empty()) {
+                logFile << logQueue.front();
+                logQueue.pop();
+            }
         }
+        drainThreadBuffers();
         logFile.flush();
     }
 }
@@ -0,0 +1,189 @@
+#ifndef OPTION_CHAIN_H
+#define OPTION_CHAIN_H
+
+#include "InstrumentMaster.h"
+#include "InstrumentRegistry.h"
+#include "TriggerIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// The CE and PE contracts of one expiry in a dense table by strike: row r
+// is the strike firstStrike + r * step. Rows the exchange does not list
+// point at the nearest listed strike, so any spot resolves in O(1).
+struct OptionExpiry {
+    int32_t day; // Days since 1970-01-01
+    Price firstStrike;
+    Price step;
+    std::vector<const Instrument*> calls, puts; // Into the InstrumentMaster
+
+    std::size_t rowOf(Price spot) const {
+        const int64_t row = (int64_t(spot) - firstStrike + step / 2) / step;
+        return static_cast<std::size_t>(
+            std::clamp<int64_t>(row, 0, int64_t(calls.size()) - 1));
+    }
+};
+
+// Option chains of the index underlyings the strategy trades, built from
+// the InstrumentMaster at startup. resolve() maps the underlying's slot, a
+// spot price and a leg to the contract to trade with a few arithmetic
+// operations, so an entry never searches or calls out for its option.
+//
+// build() is called before the feed starts; resolve() from any thread.
+class OptionChains {
+  private:
+    struct Chain {
+        uint32_t underlying; // Index token, e.g. 256265
+        std::string name;    // Name of its options, e.g. "NIFTY"
+        std::vector<OptionExpiry> expiries; // Nearest first
+    };
+
+    static constexpr uint8_t NONE = UINT8_MAX;
+
+    std::vector<Chain> chains;
+    std::vector<uint8_t> chainOfSlot; // Index into chains, NONE for none
+
+    OptionChains() : chainOfSlot(InstrumentRegistry::MAX_INSTRUMENTS, NONE) {}
+
+    // Dense table of the strikes listed for one expiry, or none if its
+    // calls and puts do not share a strike grid
+    static bool fill(OptionExpiry& expiry,
+        const std::map<Price, std::pair<const Instrument*, const Instrument*>>& strikes) {
+        if (strikes.size() < 2) {
+            return false;
+        }
+        Price step = 0;
+        for (auto it = std::next(strikes.begin()); it != strikes.end(); ++it) {
+            const Price gap = it->first - std::prev(it)->first;
+            step = (step == 0) ? gap : std::min(step, gap);
+        }
+        expiry.firstStrike = strikes.begin()->first;
+        expiry.step = step;
+        const std::size_t rows =
+            static_cast<std::size_t>((strikes.rbegin()->first - expiry.firstStrike) / step) + 1;
+        expiry.calls.assign(rows, nullptr);
+        expiry.puts.assign(rows, nullptr);
+        for (const auto& strike : strikes) {
+            if ((strike.first - expiry.firstStrike) % step != 0) {
+                return false;
+            }
+            const std::size_t row = (strike.first - expiry.firstStrike) / step;
+            expiry.calls[row] = strike.second.first;
+            expiry.puts[row] = strike.second.second;
+        }
+        // Unlisted rows and strikes with only one side take the nearest
+        // contract of their side, the lower one on a tie
+        for (auto* side : { &expiry.calls, &expiry.puts }) {
+            auto& contracts = *side;
+            std::vector<std::size_t> listed;
+            for (std::size_t row = 0; row < rows; ++row) {
+                if (contracts[row] != nullptr) {
+                    listed.push_back(row);
+                }
+            }
+            if (listed.empty()) {
+                return false;
+            }
+            // First listed row at or after row, else the last one
+            std::size_t above = 0;
+            for (std::size_t row = 0; row < rows; ++row) {
+                while (above + 1 < listed.size() && listed[above] < row) {
+                    ++above;
+                }
+                std::size_t nearest = listed[above];
+                if (nearest >= row && above > 0 &&
+                    row - listed[above - 1] <= nearest - row) {
+                    nearest = listed[above - 1];
+                }
+                contracts[row] = contracts[nearest];
+            }
+        }
+        return true;
+    }
+
+  public:
+    static OptionChains& getInstance() {
+        static OptionChains instance;
+        return instance;
+    }
+
+    // Builds the chain of the options called name (Kite's "name" column)
+    // on the index underlying, keeping expiries on or after today (days
+    // since 1970-01-01). Registers the underlying. Returns the expiries
+    // kept.
+    std::size_t build(const InstrumentMaster& master, uint32_t underlying,
+        const std::string& name, int32_t today) {
+        const uint32_t slot =
+            InstrumentRegistry::getInstance().registerToken(underlying);
+        if (slot == InstrumentRegistry::INVALID_SLOT || chains.size() >= NONE) {
+            return 0;
+        }
+        std::map<int32_t,
+            std::map<Price, std::pair<const Instrument*, const Instrument*>>>
+            byExpiry;
+        for (const Instrument& record : master) {
+            if ((record.type != Instrument::Call && record.type != Instrument::Put) ||
+                record.expiryDay < today || name != record.name) {
+                continue;
+            }
+            auto& strike = byExpiry[record.expiryDay][record.strike];
+            (record.type == Instrument::Call ? strike.first : strike.second) = &record;
+        }
+
+        Chain chain{ underlying, name, {} };
+        for (const auto& expiry : byExpiry) {
+            OptionExpiry table{ expiry.first, 0, 0, {}, {} };
+            if (fill(table, expiry.second)) {
+                chain.expiries.push_back(std::move(table));
+            }
+        }
+        if (chain.expiries.empty()) {
+            return 0;
+        }
+        chainOfSlot[slot] = static_cast<uint8_t>(chains.size());
+        chains.push_back(std::move(chain));
+        return chains.back().expiries.size();
+    }
+
+    // The contract of leg on the underlying in slot, strikesAway strikes
+    // out of the money from the one nearest spot (negative for in the
+    // money), on the expiry'th expiry from now. Null without a chain.
+    const Instrument* resolve(uint32_t slot, Price spot, Trigger::Action leg,
+        int strikesAway = 0, std::size_t expiry = 0) const {
+        const uint8_t index = chainOfSlot[slot];
+        if (index == NONE || expiry >= chains[index].expiries.size()) {
+            return nullptr;
+        }
+        const OptionExpiry& table = chains[index].expiries[expiry];
+        // Out of the money is above spot for a call, below for a put
+        const int64_t offset =
+            (leg == Trigger::EnterCall) ? strikesAway : -int64_t(strikesAway);
+        const int64_t row = std::clamp<int64_t>(
+            int64_t(table.rowOf(spot)) + offset, 0, int64_t(table.calls.size()) - 1);
+        return (leg == Trigger::EnterCall) ? table.calls[row] : table.puts[row];
+    }
+
+    // Every contract of the nearest expiry of each chain, e.g. to stream
+    // their prices
+    std::vector<uint32_t> nearestExpiryTokens() const {
+        std::vector<uint32_t> tokens;
+        for (const auto& chain : chains) {
+            const OptionExpiry& table = chain.expiries.front();
+            for (const auto* side : { &table.calls, &table.puts }) {
+                for (std::size_t row = 0; row < side->size(); ++row) {
+                    // Filled rows repeat their nearest listed contract
+                    if (row == 0 || (*side)[row] != (*side)[row - 1]) {
+                        tokens.push_back((*side)[row]->token);
+                    }
+                }
+            }
+        }
+        return tokens;
+    }
+};
+
+#endif // OPTION_CHAIN_H
@@ -0,0 +1,122 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include "InstrumentRegistry.h"
+#include "SeqLock.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+// Top of an instrument's book as the last "full" mode tick showed it, one
+// array per field, with the figures entry filters need worked out once on
+// update. Two cache lines; level 0 is the best price on each side and
+// levels past bidLevels/askLevels are zero.
+struct L2Book {
+    static constexpr int LEVELS = 5; // Kite streams five levels a side
+
+    Price bidPrice[LEVELS], askPrice[LEVELS];
+    int32_t bidQuantity[LEVELS], askQuantity[LEVELS];
+    int16_t bidOrders[LEVELS], askOrders[LEVELS];
+    uint8_t bidLevels, askLevels;
+
+    // Derived on update, 0 unless both sides have a level
+    Price spread;         // Best ask - best bid
+    Price microprice;     // Mid weighted towards the thinner side of the top
+    float topImbalance;   // (bid - ask) / (bid + ask) quantity at the top
+    float depthImbalance; // The same over every level, in [-1, 1]
+    int64_t time;         // Exchange time of the tick, epoch seconds
+
+    bool twoSided() const { return bidLevels != 0 && askLevels != 0; }
+
+    // Spread as a share of the microprice, in basis points
+    double spreadBps() const {
+        return twoSided() ? spread * 10000.0 / microprice : 0;
+    }
+
+    // Copies one side of a tick's depth, skipping Kite's empty (zero)
+    // levels, and returns the levels kept
+    template <typename Depth>
+    static uint8_t copySide(const Depth& depth, Price* prices,
+        int32_t* quantities, int16_t* orders) {
+        uint8_t levels = 0;
+        const std::size_t count = std::min<std::size_t>(depth.size(), LEVELS);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (depth[i].price > 0 && depth[i].quantity > 0) {
+                prices[levels] = toPrice(depth[i].price);
+                quantities[levels] = depth[i].quantity;
+                orders[levels] = depth[i].orders;
+                ++levels;
+            }
+        }
+        for (uint8_t i = levels; i < LEVELS; ++i) {
+            prices[i] = quantities[i] = 0;
+            orders[i] = 0;
+        }
+        return levels;
+    }
+
+    void update(const kc::tick& tick, int64_t tickTime) {
+        bidLevels = copySide(
+            tick.marketDepth.buy, bidPrice, bidQuantity, bidOrders);
+        askLevels = copySide(
+            tick.marketDepth.sell, askPrice, askQuantity, askOrders);
+        time = tickTime;
+        spread = microprice = 0;
+        topImbalance = depthImbalance = 0;
+        if (!twoSided()) {
+            return;
+        }
+        const int64_t bidTop = bidQuantity[0], askTop = askQuantity[0];
+        spread = askPrice[0] - bidPrice[0];
+        microprice = static_cast<Price>(
+            (int64_t(bidPrice[0]) * askTop + int64_t(askPrice[0]) * bidTop) /
+            (bidTop + askTop));
+        topImbalance = float(bidTop - askTop) / float(bidTop + askTop);
+        int64_t bids = 0, asks = 0;
+        for (int i = 0; i < LEVELS; ++i) {
+            bids += bidQuantity[i];
+            asks += askQuantity[i];
+        }
+        depthImbalance = float(bids - asks) / float(bids + asks);
+    }
+};
+static_assert(sizeof(L2Book) == 128, "two cache lines");
+
+// The L2Book of every instrument, indexed by registry slot. The ticker
+// thread updates a slot's book from each tick that carries depth; the
+// candle shards and the OrderManager read consistent copies from any
+// thread without a lock. Nothing allocates after construction.
+//
+// Only live "full" mode ticks carry depth; journals do not record it, so
+// replays and backtests see no book and filters on it let everything pass.
+class OrderBooks {
+  private:
+    std::unique_ptr<SeqLock<L2Book>[]> books{
+        new SeqLock<L2Book>[InstrumentRegistry::MAX_INSTRUMENTS]
+    };
+
+    OrderBooks() {} // Singleton pattern
+
+  public:
+    static OrderBooks& getInstance() {
+        static OrderBooks instance;
+        return instance;
+    }
+
+    // Called by the ticker thread only, for ticks with market depth
+    void update(uint32_t slot, const kc::tick& tick, int64_t tickTime) {
+        L2Book book;
+        book.update(tick, tickTime);
+        books[slot].store(book);
+    }
+
+    // Copies the latest book of slot into out; false (out untouched) while
+    // it has none
+    bool read(uint32_t slot, L2Book& out) const {
+        return books[slot].load(out) != 0;
+    }
+};
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,383 @@
+#ifndef ORDER_GATEWAY_H
+#define ORDER_GATEWAY_H
+
+#include "LatencyTelemetry.h"
+#include "Logger.h"
+#include "SpscRing.h"
+#include "TriggerIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// An order the strategy wants on the exchange. leg is the option bought on
+// the underlying instrument: a call for EnterCall, a put for EnterPut.
+struct OrderIntent {
+    enum Side : uint8_t { Buy, Sell };
+
+    uint64_t id; // Assigned by the submitter, unique per process
+    uint32_t slot;  // The underlying's
+    uint32_t token; // The option contract, or the underlying without a chain
+    Side side;
+    Trigger::Action leg;
+    int32_t quantity;
+    Price price;       // Last price of token when decided, 0 if unknown
+    Price underlyingPrice; // Last price of the underlying then
+    int64_t submitted; // LatencyTelemetry::now() at submit()
+    uint32_t attempts; // Sends so far, kept by the gateway
+};
+
+// What happened to an OrderIntent, reported back to the submitter
+struct OrderEvent {
+    enum Type : uint8_t { Ack, Fill, Reject };
+
+    Type type;
+    OrderIntent::Side side;
+    uint32_t slot;
+    uint64_t id;         // OrderIntent::id
+    uint64_t exchangeId; // 0 for a reject
+    Price fillPrice;     // Fills only
+    int32_t quantity;
+    uint32_t attempts;
+};
+
+// Where the gateway sends orders. Called from the gateway's I/O thread only,
+// so implementations may block on the network.
+class OrderBackend {
+  public:
+    enum class Result : uint8_t {
+        Accepted,
+        Retry,   // Transient failure, e.g. a timeout or a throttled request
+        Rejected // Final, e.g. insufficient margin
+    };
+
+    struct Reply {
+        Result result;
+        uint64_t exchangeId; // Set when accepted
+    };
+
+    virtual ~OrderBackend() = default;
+
+    // Sends count orders in one go and fills replies[0, count)
+    virtual void send(const OrderIntent* orders, std::size_t count,
+        Reply* replies) = 0;
+
+    // Appends fills of accepted orders seen since the last call, and
+    // rejects of those the exchange turned down after accepting
+    virtual void poll(std::vector<OrderEvent>& fills) = 0;
+};
+
+struct MockExchangeConfig {
+    int64_t latencyMicros = 2000;   // Mean round trip of one send()
+    int64_t jitterMicros = 500;     // Uniform +- around the mean
+    int64_t fillDelayMicros = 1000; // Accept -> fill
+    double retryRate = 0.01;        // Share of orders failing transiently
+    double rejectRate = 0.0;
+    Price slippage = 5; // Paise against the order
+    uint64_t seed = 1;
+};
+
+// Local stand-in for the exchange: accepts, fails or rejects orders at
+// configurable rates after a simulated round trip and fills accepted ones a
+// little later at the intent's price plus slippage; orders without a price
+// cannot be filled and are rejected. Seeded, so a load test sees the same
+// outcomes on every run.
+class MockExchange : public OrderBackend {
+  public:
+    using Config = MockExchangeConfig;
+
+  private:
+    struct PendingFill {
+        int64_t due; // Steady clock, nanoseconds
+        OrderEvent fill;
+    };
+
+    Config config;
+    std::mt19937_64 random;
+    std::deque<PendingFill> pending; // Ordered by due, fill delay is fixed
+    uint64_t nextExchangeId = 1;
+
+    void sleepMicros(int64_t micros) {
+        if (micros > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(micros));
+        }
+    }
+
+  public:
+    explicit MockExchange(const Config& config = {})
+        : config(config), random(config.seed) {}
+
+    void send(const OrderIntent* orders, std::size_t count,
+        Reply* replies) override {
+        std::uniform_int_distribution<int64_t> jitter(
+            -config.jitterMicros, config.jitterMicros);
+        std::uniform_real_distribution<double> outcome(0.0, 1.0);
+        sleepMicros(config.latencyMicros + jitter(random));
+
+        const int64_t due =
+            Logger::steadyNanos() + config.fillDelayMicros * 1000;
+        for (std::size_t i = 0; i < count; ++i) {
+            const OrderIntent& order = orders[i];
+            const double draw = outcome(random);
+            if (draw < config.rejectRate || order.price <= 0) {
+                replies[i] = { Result::Rejected, 0 };
+                continue;
+            }
+            if (draw < config.rejectRate + config.retryRate) {
+                replies[i] = { Result::Retry, 0 };
+                continue;
+            }
+            replies[i] = { Result::Accepted, nextExchangeId++ };
+            const Price slip =
+                (order.side == OrderIntent::Buy) ? config.slippage : -config.slippage;
+            pending.push_back({ due,
+                { OrderEvent::Fill, order.side, order.slot, order.id,
+                    replies[i].exchangeId, order.price + slip, order.quantity,
+                    order.attempts } });
+        }
+    }
+
+    void poll(std::vector<OrderEvent>& fills) override {
+        const int64_t now = Logger::steadyNanos();
+        while (!pending.empty() && pending.front().due <= now) {
+            fills.push_back(pending.front().fill);
+            pending.pop_front();
+        }
+    }
+};
+
+// Token bucket: rate tokens per second, holding at most burst
+class TokenBucket {
+  private:
+    double rate, burst, tokens;
+    int64_t last; // Nanoseconds of the last refill
+
+  public:
+    TokenBucket(double rate, double burst, int64_t now)
+        : rate(rate), burst(burst), tokens(burst), last(now) {}
+
+    // Whole tokens available at now
+    std::size_t available(int64_t now) {
+        tokens = std::min(burst, tokens + (now - last) * rate / 1e9);
+        last = now;
+        return static_cast<std::size_t>(tokens);
+    }
+
+    void take(std::size_t count) { tokens -= double(count); }
+
+    // Nanoseconds from the last refill until a whole token is available
+    int64_t wait() const {
+        return (tokens >= 1) ? 0 : static_cast<int64_t>((1 - tokens) * 1e9 / rate) + 1;
+    }
+};
+
+struct OrderGatewayConfig {
+    double ordersPerSecond = 10; // Kite's order placement limit
+    double burst = 10;
+    std::size_t maxBatch = 10;
+    uint32_t maxAttempts = 3;
+    int64_t retryBackoffMicros = 50000; // Doubled on every attempt
+    std::size_t queueCapacity = 1024;
+};
+
+// Takes orders off the strategy's threads. submit() only copies the intent
+// into a lock-free ring; a dedicated I/O thread drains it, sends whatever
+// the rate limit allows in one batch, retries transient failures with
+// exponential backoff and queues acks, fills and rejects for the submitter
+// to pick up with drainEvents().
+//
+// Both rings are single producer, single consumer: submit() must be
+// serialised by the caller (OrderManager holds orderMutex) and
+// drainEvents() called from one thread at a time.
+class OrderGateway {
+  public:
+    using Config = OrderGatewayConfig;
+
+  private:
+    struct Retry {
+        int64_t due; // Steady clock, nanoseconds
+        OrderIntent order;
+    };
+
+    static constexpr int64_t FILL_POLL_NANOS = 1000000;
+    static constexpr int64_t IDLE_WAIT_NANOS = 100000000;
+
+    Config config;
+    std::unique_ptr<OrderBackend> backend;
+    SpscRing<OrderIntent> intents;
+    SpscRing<OrderEvent> events;
+    std::thread io;
+    std::atomic<bool> running{ false };
+
+    // I/O thread state
+    std::deque<OrderIntent> ready;
+    std::vector<Retry> retries;
+    std::vector<OrderIntent> batch;
+    std::vector<OrderBackend::Reply> replies;
+    std::vector<OrderEvent> fills;
+    uint64_t awaitingFill = 0; // Acked orders the backend has not filled
+
+    void publish(const OrderEvent& event) {
+        if (!events.tryPush(event)) {
+            LOG_FAST(ERROR, "Order event dropped, event queue full, order ",
+                event.id);
+        }
+    }
+
+    void reject(const OrderIntent& order) {
+        publish({ OrderEvent::Reject, order.side, order.slot, order.id, 0, 0,
+            order.quantity, order.attempts });
+    }
+
+    // Sends what the bucket allows; returns nanoseconds until more can go
+    int64_t sendReady(TokenBucket& bucket) {
+        const int64_t now = Logger::steadyNanos();
+        for (auto it = retries.begin(); it != retries.end();) {
+            if (it->due <= now) {
+                ready.push_back(it->order);
+                it = retries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        std::size_t count = std::min(
+            { ready.size(), bucket.available(now), config.maxBatch });
+        if (count != 0) {
+            batch.assign(ready.begin(), ready.begin() + count);
+            ready.erase(ready.begin(), ready.begin() + count);
+            bucket.take(count);
+            replies.resize(count);
+            for (auto& order : batch) {
+                ++order.attempts;
+            }
+            backend->send(batch.data(), count, replies.data());
+
+            auto& telemetry = LatencyTelemetry::getInstance();
+            const int64_t sent = Logger::steadyNanos();
+            for (std::size_t i = 0; i < count; ++i) {
+                const OrderIntent& order = batch[i];
+                switch (replies[i].result) {
+                case OrderBackend::Result::Accepted:
+                    telemetry.record(Stage::OrderAck, order.submitted);
+                    ++awaitingFill;
+                    publish({ OrderEvent::Ack, order.side, order.slot, order.id,
+                        replies[i].exchangeId, 0, order.quantity,
+                        order.attempts });
+                    break;
+                case OrderBackend::Result::Retry:
+                    if (order.attempts < config.maxAttempts) {
+                        retries.push_back({ sent +
+                                                (config.retryBackoffMicros * 1000
+                                                    << (order.attempts - 1)),
+                            order });
+                        break;
+                    }
+                    reject(order);
+                    break;
+                case OrderBackend::Result::Rejected:
+                    reject(order);
+                    break;
+                }
+            }
+        }
+
+        if (!ready.empty()) {
+            return bucket.wait();
+        }
+        int64_t next = std::numeric_limits<int64_t>::max();
+        for (const auto& retry : retries) {
+            next = std::min(next, retry.due - Logger::steadyNanos());
+        }
+        return std::max<int64_t>(next, 0);
+    }
+
+    void run() {
+        TokenBucket bucket(
+            config.ordersPerSecond, config.burst, Logger::steadyNanos());
+        for (;;) {
+            const bool stopping = !running.load(std::memory_order_acquire);
+            intents.drain([this](const OrderIntent& order) {
+                ready.push_back(order);
+            });
+            int64_t wait = std::min(sendReady(bucket), IDLE_WAIT_NANOS);
+
+            fills.clear();
+            backend->poll(fills);
+            for (const auto& fill : fills) {
+                publish(fill);
+            }
+            awaitingFill -= std::min<uint64_t>(awaitingFill, fills.size());
+            if (stopping && ready.empty() && retries.empty()) {
+                return;
+            }
+
+            if (awaitingFill != 0) {
+                wait = std::min(wait, FILL_POLL_NANOS);
+            }
+            if (wait > 0) {
+                intents.waitForData(std::chrono::milliseconds(
+                    std::max<int64_t>(1, wait / 1000000)));
+            }
+        }
+    }
+
+  public:
+    OrderGateway(std::unique_ptr<OrderBackend> backend, const Config& config = {})
+        : config(config), backend(std::move(backend)),
+          intents(config.queueCapacity), events(config.queueCapacity * 4) {}
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    ~OrderGateway() { stop(); }
+
+    void start() {
+        if (running.exchange(true)) {
+            return;
+        }
+        LatencyTelemetry::getInstance().setGauge(
+            "order_queue", [this] { return intents.stats().depth; });
+        io = std::thread([this] { run(); });
+    }
+
+    // Sends what is still queued, waiting out the rate limit and retries
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        intents.notify();
+        io.join();
+        LatencyTelemetry::getInstance().setGauge(
+            "order_queue", [] { return uint64_t(0); });
+    }
+
+    // Queues order for sending; false when the queue is full
+    bool submit(const OrderIntent& order) {
+        bool queued = intents.tryPushWith([&order](OrderIntent& slot) {
+            slot = order;
+            slot.submitted = LatencyTelemetry::now();
+            slot.attempts = 0;
+        });
+        intents.notify();
+        return queued;
+    }
+
+    // Hands every event reported so far to fn
+    template <typename Fn>
+    std::size_t drainEvents(Fn&& fn) {
+        return events.drain(std::forward<Fn>(fn));
+    }
+
+    SpscRingStats queueStats() const { return intents.stats(); }
+};
+
+#endif // ORDER_GATEWAY_H
@@ -0,0 +1,258 @@
+#ifndef PATTERN_ENGINE_H
+#define PATTERN_ENGINE_H
+
+#include "Types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// One bit per pattern in a signal mask
+enum PatternBit : uint32_t {
+    DAY_LOW_REVERSAL = 1u << 0,  // Red then green at the day low
+    DAY_HIGH_REVERSAL = 1u << 1, // Green then red at the day high
+    BULLISH_ENGULFING = 1u << 2,
+    BEARISH_ENGULFING = 1u << 3,
+    INSIDE_BAR = 1u << 4,
+    ORB_BREAKOUT_UP = 1u << 5,   // First close above the opening range
+    ORB_BREAKOUT_DOWN = 1u << 6, // First close below the opening range
+    VWAP_RECLAIM = 1u << 7,      // Close back above VWAP
+    VWAP_LOSS = 1u << 8,         // Close back below VWAP
+};
+
+// Inputs of the instruments of one timeframe, one array per field. Row r
+// holds the last two closed candles of one instrument.
+struct PatternColumns {
+    std::vector<Price> prevOpen, prevHigh, prevLow, prevClose;
+    std::vector<Price> open, high, low, close;
+    std::vector<Price> dayHigh, dayLow;
+    std::vector<Price> orHigh, orLow; // Opening range of the session
+    std::vector<Price> vwap;          // 0 while unknown
+    std::vector<int32_t> hasPrev;     // 1 when prev* holds a candle
+    std::vector<int32_t> orReady;     // 1 once the opening range is complete
+
+    void resize(std::size_t n) {
+        for (auto* column : { &prevOpen, &prevHigh, &prevLow, &prevClose,
+                 &open, &high, &low, &close, &dayHigh, &dayLow, &orHigh,
+                 &orLow, &vwap, &hasPrev, &orReady }) {
+            column->assign(n, 0);
+        }
+    }
+};
+
+// A pattern ORs its bit into masks[r] for every row in [begin, end) where it
+// holds. Loops are kept branch free over the columns so the compiler turns
+// them into SIMD code.
+struct PatternDef {
+    const char* name;
+    uint32_t bit;
+    void (*evaluate)(const PatternColumns& c, std::size_t begin,
+        std::size_t end, const StrategyParams& params, uint32_t* masks);
+};
+
+namespace patterns {
+
+// Candle colours follow finalizeCandle: green only when close > open
+inline void dayLowReversal(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams& params, uint32_t* masks) {
+    const Price *po = c.prevOpen.data(), *pc = c.prevClose.data(),
+                *o = c.open.data(), *cl = c.close.data(), *l = c.low.data(),
+                *dl = c.dayLow.data();
+    const int32_t* prev = c.hasPrev.data();
+    const double proximity = params.proximityPercent;
+    for (std::size_t r = begin; r < end; ++r) {
+        double ratio = (std::abs(l[r] - dl[r]) / double(dl[r])) * 100;
+        bool hit = prev[r] & (po[r] >= pc[r]) & (o[r] < cl[r]) &
+                   ((l[r] <= dl[r]) | (ratio <= proximity));
+        masks[r] |= DAY_LOW_REVERSAL * uint32_t(hit);
+    }
+}
+
+inline void dayHighReversal(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams& params, uint32_t* masks) {
+    const Price *po = c.prevOpen.data(), *pc = c.prevClose.data(),
+                *o = c.open.data(), *cl = c.close.data(), *h = c.high.data(),
+                *dh = c.dayHigh.data();
+    const int32_t* prev = c.hasPrev.data();
+    const double proximity = params.proximityPercent;
+    for (std::size_t r = begin; r < end; ++r) {
+        double ratio = (std::abs(h[r] - dh[r]) / double(dh[r])) * 100;
+        bool hit = prev[r] & (po[r] < pc[r]) & (o[r] >= cl[r]) &
+                   ((h[r] >= dh[r]) | (ratio <= proximity));
+        masks[r] |= DAY_HIGH_REVERSAL * uint32_t(hit);
+    }
+}
+
+inline void engulfing(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams&, uint32_t* masks) {
+    const Price *po = c.prevOpen.data(), *pc = c.prevClose.data(),
+                *o = c.open.data(), *cl = c.close.data();
+    const int32_t* prev = c.hasPrev.data();
+    for (std::size_t r = begin; r < end; ++r) {
+        bool bullish = prev[r] & (po[r] > pc[r]) & (o[r] < cl[r]) &
+                       (o[r] <= pc[r]) & (cl[r] >= po[r]);
+        bool bearish = prev[r] & (po[r] < pc[r]) & (o[r] > cl[r]) &
+                       (o[r] >= pc[r]) & (cl[r] <= po[r]);
+        masks[r] |= (BULLISH_ENGULFING * uint32_t(bullish)) |
+                    (BEARISH_ENGULFING * uint32_t(bearish));
+    }
+}
+
+inline void insideBar(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams&, uint32_t* masks) {
+    const Price *ph = c.prevHigh.data(), *pl = c.prevLow.data(),
+                *h = c.high.data(), *l = c.low.data();
+    const int32_t* prev = c.hasPrev.data();
+    for (std::size_t r = begin; r < end; ++r) {
+        bool hit = prev[r] & (h[r] <= ph[r]) & (l[r] >= pl[r]);
+        masks[r] |= INSIDE_BAR * uint32_t(hit);
+    }
+}
+
+inline void openingRangeBreakout(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams&, uint32_t* masks) {
+    const Price *pc = c.prevClose.data(), *cl = c.close.data(),
+                *oh = c.orHigh.data(), *ol = c.orLow.data();
+    const int32_t *prev = c.hasPrev.data(), *ready = c.orReady.data();
+    for (std::size_t r = begin; r < end; ++r) {
+        bool up = prev[r] & ready[r] & (cl[r] > oh[r]) & (pc[r] <= oh[r]);
+        bool down = prev[r] & ready[r] & (cl[r] < ol[r]) & (pc[r] >= ol[r]);
+        masks[r] |= (ORB_BREAKOUT_UP * uint32_t(up)) |
+                    (ORB_BREAKOUT_DOWN * uint32_t(down));
+    }
+}
+
+inline void vwapCross(const PatternColumns& c, std::size_t begin,
+    std::size_t end, const StrategyParams&, uint32_t* masks) {
+    const Price *pc = c.prevClose.data(), *cl = c.close.data(),
+                *v = c.vwap.data();
+    const int32_t* prev = c.hasPrev.data();
+    for (std::size_t r = begin; r < end; ++r) {
+        bool known = prev[r] & (v[r] > 0);
+        bool reclaim = known & (pc[r] < v[r]) & (cl[r] > v[r]);
+        bool loss = known & (pc[r] > v[r]) & (cl[r] < v[r]);
+        masks[r] |= (VWAP_RECLAIM * uint32_t(reclaim)) |
+                    (VWAP_LOSS * uint32_t(loss));
+    }
+}
+
+} // namespace patterns
+
+// Patterns evaluated by every PatternEngine; registerPattern() adds to it
+// before the engines are created
+inline std::vector<PatternDef>& patternRegistry() {
+    static std::vector<PatternDef> registry = {
+        { "DayLowReversal", DAY_LOW_REVERSAL, &patterns::dayLowReversal },
+        { "DayHighReversal", DAY_HIGH_REVERSAL, &patterns::dayHighReversal },
+        { "Engulfing", BULLISH_ENGULFING | BEARISH_ENGULFING,
+            &patterns::engulfing },
+        { "InsideBar", INSIDE_BAR, &patterns::insideBar },
+        { "OpeningRangeBreakout", ORB_BREAKOUT_UP | ORB_BREAKOUT_DOWN,
+            &patterns::openingRangeBreakout },
+        { "VwapCross", VWAP_RECLAIM | VWAP_LOSS, &patterns::vwapCross },
+    };
+    return registry;
+}
+
+inline void registerPattern(const PatternDef& pattern) {
+    patternRegistry().push_back(pattern);
+}
+
+// Name of a single pattern bit, for logging
+inline const char* patternName(uint32_t bit) {
+    switch (bit) {
+    case DAY_LOW_REVERSAL: return "DayLowReversal";
+    case DAY_HIGH_REVERSAL: return "DayHighReversal";
+    case BULLISH_ENGULFING: return "BullishEngulfing";
+    case BEARISH_ENGULFING: return "BearishEngulfing";
+    case INSIDE_BAR: return "InsideBar";
+    case ORB_BREAKOUT_UP: return "OrbBreakoutUp";
+    case ORB_BREAKOUT_DOWN: return "OrbBreakoutDown";
+    case VWAP_RECLAIM: return "VwapReclaim";
+    case VWAP_LOSS: return "VwapLoss";
+    default: return "Custom";
+    }
+}
+
+// Evaluates every registered pattern for the instruments of one timeframe in
+// one pass. Closed candles are packed into the columns in the order they
+// are staged, so evaluate() runs each pattern over exactly the staged
+// instruments, contiguous however far apart their rows are.
+class PatternEngine {
+  private:
+    PatternColumns columns; // Packed, [0, count) staged
+    std::vector<uint32_t> masks; // Indexed like columns
+    std::vector<uint32_t> rows;  // Instrument row of each packed one
+    std::vector<uint32_t> packed; // Packed index of each row as last staged
+    std::vector<uint8_t> staged;
+    std::size_t count = 0;
+
+  public:
+    explicit PatternEngine(std::size_t rows = 0) { resize(rows); }
+
+    void resize(std::size_t rowCount) {
+        columns.resize(rowCount);
+        masks.assign(rowCount, 0);
+        rows.assign(rowCount, 0);
+        packed.assign(rowCount, 0);
+        staged.assign(rowCount, 0);
+        count = 0;
+    }
+
+    bool isStaged(std::size_t row) const { return staged[row] != 0; }
+    bool empty() const { return count == 0; }
+
+    // Copies the last closed candles of data and its indicators into the
+    // next packed row; row must not be staged already
+    void stage(std::size_t row, const ScripData& data) {
+        const std::size_t r = count++;
+        rows[r] = static_cast<uint32_t>(row);
+        packed[row] = static_cast<uint32_t>(r);
+        staged[row] = 1;
+
+        const Candle& current = data.candles.back();
+        PatternColumns& c = columns;
+        c.open[r] = current.open;
+        c.high[r] = current.high;
+        c.low[r] = current.low;
+        c.close[r] = current.close;
+        // A filled-in flat bar is no previous candle to a pattern
+        c.hasPrev[r] = data.candles.size() > 1 &&
+                       data.candles[data.candles.size() - 2].color !=
+                           CandleColor::Flat;
+        if (c.hasPrev[r]) {
+            const Candle& prev = data.candles[data.candles.size() - 2];
+            c.prevOpen[r] = prev.open;
+            c.prevHigh[r] = prev.high;
+            c.prevLow[r] = prev.low;
+            c.prevClose[r] = prev.close;
+        }
+        c.dayHigh[r] = data.dayHigh;
+        c.dayLow[r] = data.dayLow;
+        c.vwap[r] = data.indicators.vwap;
+        c.orHigh[r] = data.indicators.rangeHigh;
+        c.orLow[r] = data.indicators.rangeLow;
+        c.orReady[r] = data.indicators.rangeReady;
+    }
+
+    // Runs every pattern over the staged rows and clears them. The masks of
+    // the staged rows stay readable through mask() until the next stage().
+    void evaluate(const StrategyParams& params) {
+        if (empty()) {
+            return;
+        }
+        std::fill(masks.begin(), masks.begin() + count, 0);
+        for (const auto& pattern : patternRegistry()) {
+            pattern.evaluate(columns, 0, count, params, masks.data());
+        }
+        for (std::size_t r = 0; r < count; ++r) {
+            staged[rows[r]] = 0;
+        }
+        count = 0;
+    }
+
+    uint32_t mask(std::size_t row) const { return masks[packed[row]]; }
+};
+
+#endif // PATTERN_ENGINE_H
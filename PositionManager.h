@@ -0,0 +1,129 @@
+#ifndef POSITION_MANAGER_H
+#define POSITION_MANAGER_H
+
+#include "TimerWheel.h"
+#include "TriggerIndex.h"
+#include "Types.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class ExitReason : uint8_t {
+    StopLoss,  // Initial or trailed stop traded through
+    TimeLimit, // Held for maxHoldMinutes or reached the square-off time
+    SessionEnd // closeAll(), e.g. at the end of a backtest
+};
+
+inline const char* exitReasonName(ExitReason reason) {
+    switch (reason) {
+    case ExitReason::StopLoss: return "SL";
+    case ExitReason::TimeLimit: return "time";
+    case ExitReason::SessionEnd: return "session end";
+    }
+    return "";
+}
+
+struct ClosedTrade {
+    uint32_t slot;
+    Trigger::Action side;
+    Price entryPrice;
+    Price exitPrice;
+    int64_t entryTime; // Exchange time, epoch seconds
+    int64_t exitTime;
+    ExitReason reason;
+
+    // Index points gained, in paise
+    int64_t pnl() const {
+        return (side == Trigger::EnterCall) ? int64_t(exitPrice) - entryPrice
+                                            : int64_t(entryPrice) - exitPrice;
+    }
+};
+
+// Every open position in one flat table indexed by InstrumentRegistry slot.
+// Stops are checked on each tick of the instrument, trailed on candle
+// closes, and time-based exits wait in a TimerWheel driven by exchange
+// time, so an exit happens on the first tick batch past its deadline with
+// no thread or sleep per position. Not thread safe; the OrderManager
+// guards it with orderMutex.
+class PositionManager {
+  private:
+    std::vector<Position> positions;
+    std::vector<ClosedTrade> closed;
+    TimerWheel timeExits;
+
+  public:
+    explicit PositionManager(std::size_t capacity)
+        : positions(capacity), timeExits(capacity) {}
+
+    const Position& operator[](uint32_t slot) const { return positions[slot]; }
+    std::size_t size() const { return positions.size(); }
+
+    // Opens or, after a restart, reopens the position of slot
+    void open(uint32_t slot, const Position& position) {
+        positions[slot] = position;
+        timeExits.cancel(slot);
+        if (position.open && position.exitBy != 0) {
+            timeExits.schedule(slot, position.exitBy);
+        }
+    }
+
+    bool stopHit(uint32_t slot, Price price) const {
+        const Position& position = positions[slot];
+        if (!position.open) {
+            return false;
+        }
+        return (position.side == Trigger::EnterCall) ? price < position.stopLoss
+                                                     : price > position.stopLoss;
+    }
+
+    // Trails the stop to the far end of a closed candle against the
+    // position; returns whether it moved
+    bool trail(uint32_t slot, const Candle& candle) {
+        Position& position = positions[slot];
+        if (!position.open || candle.endTime < position.trailFrom) {
+            return false;
+        }
+        if (position.side == Trigger::EnterCall &&
+            candle.color == CandleColor::Red) {
+            position.stopLoss = candle.low;
+        } else if (position.side == Trigger::EnterPut &&
+                   candle.color == CandleColor::Green) {
+            position.stopLoss = candle.high;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const ClosedTrade& close(
+        uint32_t slot, Price exitPrice, int64_t exitTime, ExitReason reason) {
+        Position& position = positions[slot];
+        closed.push_back({ slot, position.side, position.entryPrice, exitPrice,
+            position.entryTime, exitTime, reason });
+        position.open = false;
+        timeExits.cancel(slot);
+        return closed.back();
+    }
+
+    // Drops the open position of slot without booking a trade, e.g. when
+    // its entry order never filled
+    void cancel(uint32_t slot) {
+        positions[slot].open = false;
+        timeExits.cancel(slot);
+    }
+
+    // Moves exchange time to now and calls expired(slot) for every open
+    // position whose exitBy has passed. expired is expected to close it.
+    template <typename Expired>
+    void advance(int64_t now, Expired&& expired) {
+        timeExits.advance(now, [&](uint32_t slot) {
+            if (positions[slot].open) {
+                expired(slot);
+            }
+        });
+    }
+
+    const std::vector<ClosedTrade>& closedTrades() const { return closed; }
+};
+
+#endif // POSITION_MANAGER_H
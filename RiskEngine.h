@@ -0,0 +1,217 @@
+#ifndef RISK_ENGINE_H
+#define RISK_ENGINE_H
+
+#include "InstrumentRegistry.h"
+#include "SessionClock.h"
+#include "TriggerIndex.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Pre-trade limits every entry is checked against before its order goes
+// out. 0 turns a check off; the defaults check nothing.
+struct RiskLimits {
+    // Option quantity open on one underlying at a time
+    int32_t maxQuantityPerInstrument = 0;
+    // Positions open across every instrument
+    uint32_t maxOpenPositions = 0;
+    // Orders, entries and exits, per second of exchange time. Exits are
+    // counted but never refused.
+    uint32_t maxOrdersPerSecond = 0;
+    // Rupees lost in a session, booked at the option contracts' own entry
+    // and exit prices times quantity, after which no entry is taken until
+    // the next session
+    int64_t maxDailyLoss = 0;
+    // An entry on the same instrument and leg within this many seconds of
+    // the last one admitted is a duplicate signal
+    int duplicateSeconds = 0;
+};
+
+enum class RiskCheck : uint8_t {
+    Passed,
+    InstrumentLimit,
+    OpenPositions,
+    OrderRate,
+    DailyLoss,
+    Duplicate,
+    Count
+};
+
+inline const char* riskCheckName(RiskCheck check) {
+    static const char* const names[] = { "passed", "instrument limit",
+        "open positions", "order rate", "daily loss", "duplicate" };
+    return names[static_cast<std::size_t>(check)];
+}
+
+// Exposure accounting and pre-trade checks of one OrderManager. Every
+// counter is an atomic updated with a handful of relaxed read-modify-writes,
+// so admitting an entry costs nanoseconds and never takes orderMutex. An
+// admitted entry holds its quantity and position until exited() or
+// release() gives them back; a check that fails rolls back what the ones
+// before it reserved, so the limits hold however many threads admit at once.
+//
+// Limits are set before ticks flow; the rest may be called from any thread.
+class RiskEngine {
+  private:
+    static constexpr int COUNT_BITS = 24; // Of rateWindow, below the second
+
+    RiskLimits limits;
+    // Open quantity per slot
+    std::unique_ptr<std::atomic<int32_t>[]> exposure{
+        new std::atomic<int32_t>[InstrumentRegistry::MAX_INSTRUMENTS]()
+    };
+    // Exchange time * 2 + leg of the last entry admitted per slot, 0 for none
+    std::unique_ptr<std::atomic<int64_t>[]> lastEntry{
+        new std::atomic<int64_t>[InstrumentRegistry::MAX_INSTRUMENTS]()
+    };
+    std::atomic<uint32_t> openPositions{ 0 };
+    // Exchange second << COUNT_BITS | orders sent in it
+    std::atomic<uint64_t> rateWindow{ 0 };
+    // Session origin and the paise booked in it, times quantity
+    std::atomic<int64_t> session{ 0 };
+    std::atomic<int64_t> sessionPnl{ 0 };
+    std::atomic<uint64_t> rejections[static_cast<std::size_t>(RiskCheck::Count)] = {};
+
+    // Counts an order in the second of time; false, counting nothing, when
+    // limited and the second already had maxOrdersPerSecond
+    bool countOrder(int64_t time, bool limited) {
+        constexpr uint64_t COUNT_MASK = (uint64_t(1) << COUNT_BITS) - 1;
+        uint64_t window = rateWindow.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            // An order stamped before the current second counts in it
+            const uint64_t second =
+                std::max(window >> COUNT_BITS, static_cast<uint64_t>(time));
+            const uint64_t sent =
+                (second == window >> COUNT_BITS) ? window & COUNT_MASK : 0;
+            if (limited && limits.maxOrdersPerSecond != 0 &&
+                sent >= limits.maxOrdersPerSecond) {
+                return false;
+            }
+            next = second << COUNT_BITS | (sent + 1);
+        } while (!rateWindow.compare_exchange_weak(
+            window, next, std::memory_order_relaxed));
+        return true;
+    }
+
+    // Starts a new session P&L once time is past the current session
+    void rollSession(int64_t time) {
+        const int64_t origin = SessionClock::sessionOrigin(time);
+        int64_t current = session.load(std::memory_order_relaxed);
+        if (origin > current &&
+            session.compare_exchange_strong(current, origin, std::memory_order_relaxed)) {
+            sessionPnl.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    RiskCheck reject(RiskCheck check) {
+        rejections[static_cast<std::size_t>(check)].fetch_add(
+            1, std::memory_order_relaxed);
+        return check;
+    }
+
+  public:
+    void setLimits(const RiskLimits& riskLimits) { limits = riskLimits; }
+    const RiskLimits& riskLimits() const { return limits; }
+
+    // Checks an entry of quantity on the leg of slot at exchange time and,
+    // if every check passes, counts its order and reserves its exposure
+    RiskCheck admit(uint32_t slot, Trigger::Action leg, int32_t quantity,
+        int64_t time) {
+        rollSession(time);
+        if (limits.maxDailyLoss != 0 &&
+            sessionPnl.load(std::memory_order_relaxed) <=
+                -limits.maxDailyLoss * int64_t(PRICE_SCALE)) {
+            return reject(RiskCheck::DailyLoss);
+        }
+        const int64_t stamp = time * 2 + (leg == Trigger::EnterPut);
+        int64_t last = lastEntry[slot].load(std::memory_order_relaxed);
+        auto duplicate = [this, stamp](int64_t previous) {
+            return limits.duplicateSeconds != 0 && previous != 0 &&
+                   (previous & 1) == (stamp & 1) &&
+                   stamp - previous < int64_t(limits.duplicateSeconds) * 2;
+        };
+        if (duplicate(last)) {
+            return reject(RiskCheck::Duplicate);
+        }
+
+        const int32_t held =
+            exposure[slot].fetch_add(quantity, std::memory_order_relaxed) + quantity;
+        if (limits.maxQuantityPerInstrument != 0 &&
+            held > limits.maxQuantityPerInstrument) {
+            exposure[slot].fetch_sub(quantity, std::memory_order_relaxed);
+            return reject(RiskCheck::InstrumentLimit);
+        }
+        const uint32_t open =
+            openPositions.fetch_add(1, std::memory_order_relaxed) + 1;
+        RiskCheck failed = RiskCheck::Passed;
+        if (limits.maxOpenPositions != 0 && open > limits.maxOpenPositions) {
+            failed = RiskCheck::OpenPositions;
+        } else if (!countOrder(time, true)) {
+            failed = RiskCheck::OrderRate;
+        } else {
+            // Claims the slot, so of two entries racing on it one passes
+            while (!lastEntry[slot].compare_exchange_weak(
+                last, stamp, std::memory_order_relaxed)) {
+                if (duplicate(last)) {
+                    failed = RiskCheck::Duplicate;
+                    break;
+                }
+            }
+        }
+        if (failed != RiskCheck::Passed) {
+            openPositions.fetch_sub(1, std::memory_order_relaxed);
+            exposure[slot].fetch_sub(quantity, std::memory_order_relaxed);
+            return reject(failed);
+        }
+        return RiskCheck::Passed;
+    }
+
+    // Gives back the exposure of an admitted entry whose order never went
+    // out. Its order stays counted and it still guards against duplicates.
+    void release(uint32_t slot, int32_t quantity) {
+        exposure[slot].fetch_sub(quantity, std::memory_order_relaxed);
+        openPositions.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Holds the exposure of a position reopened after a restart
+    void reopened(uint32_t slot, int32_t quantity) {
+        exposure[slot].fetch_add(quantity, std::memory_order_relaxed);
+        openPositions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Gives back the exposure of a position exited at exchange time, counts
+    // its order and books pnl (paise times quantity) to the session
+    void exited(uint32_t slot, int32_t quantity, int64_t pnl, int64_t time) {
+        release(slot, quantity);
+        countOrder(time, false);
+        rollSession(time);
+        sessionPnl.fetch_add(pnl, std::memory_order_relaxed);
+    }
+
+    int32_t openQuantity(uint32_t slot) const {
+        return exposure[slot].load(std::memory_order_relaxed);
+    }
+    uint32_t positionsOpen() const {
+        return openPositions.load(std::memory_order_relaxed);
+    }
+    // Paise booked this session, times quantity
+    int64_t dailyPnl() const { return sessionPnl.load(std::memory_order_relaxed); }
+
+    uint64_t rejected(RiskCheck check) const {
+        return rejections[static_cast<std::size_t>(check)].load(
+            std::memory_order_relaxed);
+    }
+    uint64_t rejectedTotal() const {
+        uint64_t total = 0;
+        for (const auto& count : rejections) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+#endif // RISK_ENGINE_H
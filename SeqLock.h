@@ -0,0 +1,74 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Versioned snapshot of a trivially copyable T with a single writer and any
+// number of readers. The sequence is odd while a store is in progress;
+// readers copy the value and retry if the sequence was odd or moved under
+// them. Neither side takes a lock or touches the heap, and readers never
+// hold up the writer. The value is kept as relaxed atomic words, so a read
+// overlapping a store is a retry, not a data race.
+template <typename T>
+class alignas(64) SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "snapshots are copied word by word");
+
+  private:
+    static constexpr std::size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> sequence{ 0 };
+    std::atomic<uint64_t> words[WORDS];
+
+  public:
+    SeqLock() {
+        for (auto& word : words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Called by the one writer only
+    void store(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        const uint32_t begin = sequence.load(std::memory_order_relaxed);
+        sequence.store(begin + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(begin + 2, std::memory_order_release);
+    }
+
+    // Copies the last stored value into out and returns how many stores
+    // it has seen, 0 (leaving out alone) before the first
+    uint32_t load(T& out) const {
+        uint64_t buffer[WORDS];
+        uint32_t begin, end;
+        do {
+            begin = sequence.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < WORDS; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = sequence.load(std::memory_order_relaxed);
+        } while ((begin & 1) != 0 || begin != end);
+        if (begin != 0) {
+            std::memcpy(&out, buffer, sizeof(T));
+        }
+        return begin / 2;
+    }
+
+    // Stores so far; a reader can skip load() while this is unchanged
+    uint32_t version() const {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+};
+
+#endif // SEQ_LOCK_H
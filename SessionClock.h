@@ -0,0 +1,61 @@
+#ifndef SESSION_CLOCK_H
+#define SESSION_CLOCK_H
+
+#include <cstdint>
+
+// Integer time arithmetic for the NSE session. Every value is Unix epoch
+// seconds, and IST has no daylight saving, so candle boundaries can be derived
+// with a few divisions and no localtime/mktime calls.
+namespace SessionClock {
+
+constexpr int64_t DAY_SECONDS = 24 * 60 * 60;
+constexpr int64_t IST_OFFSET_SECONDS = 5 * 60 * 60 + 30 * 60;
+constexpr int64_t SESSION_OPEN_SECONDS = 9 * 60 * 60 + 15 * 60; // 09:15 IST
+constexpr int64_t SESSION_LENGTH_SECONDS = 6 * 60 * 60 + 15 * 60; // To 15:30
+
+constexpr int64_t floorDiv(int64_t value, int64_t divisor) {
+    return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Epoch second of 09:15 IST on the calendar day (IST) containing epochSeconds
+constexpr int64_t sessionOrigin(int64_t epochSeconds) {
+    const int64_t istDay =
+        floorDiv(epochSeconds + IST_OFFSET_SECONDS, DAY_SECONDS);
+    return istDay * DAY_SECONDS + SESSION_OPEN_SECONDS - IST_OFFSET_SECONDS;
+}
+
+// Start of the interval containing epochSeconds, with intervals anchored at
+// the session origin so a 15-minute bar always spans 09:15-09:30 and so on
+constexpr int64_t bucketStart(
+    int64_t epochSeconds, int64_t origin, int64_t intervalSeconds) {
+    return origin +
+           floorDiv(epochSeconds - origin, intervalSeconds) * intervalSeconds;
+}
+
+// Caches the session origin of the current trading day, so the common case
+// costs one comparison plus the bucket division
+class Origin {
+  private:
+    int64_t origin = 0;
+    int64_t nextDay = 0; // First epoch second that belongs to the next day
+
+  public:
+    int64_t of(int64_t epochSeconds) {
+        if (epochSeconds >= nextDay || epochSeconds < nextDay - DAY_SECONDS) {
+            origin = sessionOrigin(epochSeconds);
+            nextDay = origin - SESSION_OPEN_SECONDS + DAY_SECONDS;
+        }
+        return origin;
+    }
+};
+
+static_assert(sessionOrigin(1704080700) == 1704080700, "09:15 IST, 1 Jan 2024");
+static_assert(sessionOrigin(1704118800) == 1704080700, "19:50 IST, 1 Jan 2024");
+static_assert(bucketStart(1704081599, 1704080700, 900) == 1704080700,
+    "09:29:59 IST still belongs to the 09:15 bar");
+static_assert(bucketStart(1704081600, 1704080700, 900) == 1704081600,
+    "09:30 IST opens the next 15-minute bar");
+
+} // namespace SessionClock
+
+#endif // SESSION_CLOCK_H
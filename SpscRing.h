@@ -0,0 +1,209 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// How the consumer of an SpscRing waits once the ring runs dry
+enum class WaitPolicy { Spin, Yield, Block };
+
+struct SpscRingStats {
+    uint64_t pushed;
+    uint64_t dropped;      // Pushes rejected because the ring was full
+    uint64_t backpressure; // Pushes that found the ring above the high mark
+    std::size_t depth;
+};
+
+// Bounded single-producer/single-consumer ring. The producer never blocks and
+// never takes a lock: when the ring is full the element is dropped and
+// counted. Slots are preallocated and reused, so pushing a type that owns
+// memory (e.g. kc::tick) stops allocating once every slot has been written.
+template <typename T>
+class SpscRing {
+  private:
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    // Producer side
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+    std::size_t cachedHead = 0;
+    std::atomic<uint64_t> pushedCount{0};
+    std::atomic<uint64_t> droppedCount{0};
+    std::atomic<uint64_t> backpressureCount{0};
+
+    // Consumer side
+    alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+    std::size_t cachedTail = 0;
+
+    // Block policy handshake
+    alignas(CACHE_LINE) std::atomic<uint32_t> wakeSeq{0};
+    std::atomic<bool> consumerSleeping{false};
+
+    alignas(CACHE_LINE) std::vector<T> slots;
+    const std::size_t mask;
+    const std::size_t highWaterMark;
+    WaitPolicy waitPolicy;
+
+    static std::size_t roundUpPow2(std::size_t n) {
+        std::size_t size = 2;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+  public:
+    explicit SpscRing(std::size_t capacity, WaitPolicy policy = WaitPolicy::Block)
+        : slots(roundUpPow2(capacity)), mask(slots.size() - 1),
+          highWaterMark(slots.size() - slots.size() / 4), waitPolicy(policy) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Must be called before the consumer thread starts
+    void setWaitPolicy(WaitPolicy policy) { waitPolicy = policy; }
+
+    bool tryPush(const T& value) {
+        return tryPushWith([&value](T& slot) { slot = value; });
+    }
+
+    // Lets the producer fill the slot in place instead of copying a T in
+    template <typename Fill>
+    bool tryPushWith(Fill&& fill) {
+        if (tryPushWithoutDrop(fill)) {
+            return true;
+        }
+        droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return false;
+    }
+
+  private:
+    template <typename Fill>
+    bool tryPushWithoutDrop(Fill& fill) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) {
+                return false;
+            }
+        }
+        if (t - cachedHead >= highWaterMark) {
+            backpressureCount.store(
+                backpressureCount.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        }
+        fill(slots[t & mask]);
+        tail.store(t + 1, std::memory_order_release);
+        pushedCount.store(pushedCount.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return true;
+    }
+
+  public:
+    // Lossless variant of tryPushWith for replays: waits for the consumer to
+    // free a slot instead of dropping
+    template <typename Fill>
+    void pushWith(Fill&& fill) {
+        while (!tryPushWithoutDrop(fill)) {
+            notify();
+            std::this_thread::yield();
+        }
+    }
+
+    // Called by the producer once per batch, so a sleeping consumer costs one
+    // syscall per batch rather than one per element.
+    void notify() {
+        if (waitPolicy != WaitPolicy::Block) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerSleeping.load(std::memory_order_relaxed)) {
+            wakeSeq.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wakeSeq),
+                FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+        }
+    }
+
+    // Hands every available element to fn and returns how many were consumed
+    template <typename Fn>
+    std::size_t drain(Fn&& fn) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        cachedTail = tail.load(std::memory_order_acquire);
+        const std::size_t count = cachedTail - h;
+        for (; h != cachedTail; ++h) {
+            fn(slots[h & mask]);
+        }
+        head.store(h, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+    // Waits until the producer publishes something or the timeout expires
+    void waitForData(std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) {
+        if (waitPolicy != WaitPolicy::Block) {
+            // Poll the clock only every so often to keep the spin loop tight
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (uint32_t spins = 1; empty(); ++spins) {
+                if (waitPolicy == WaitPolicy::Yield) {
+                    std::this_thread::yield();
+                }
+#if defined(__x86_64__) || defined(__i386__)
+                else {
+                    __builtin_ia32_pause();
+                }
+#endif
+                if ((spins & 1023) == 0 &&
+                    std::chrono::steady_clock::now() >= deadline) {
+                    return;
+                }
+            }
+            return;
+        }
+#ifdef __linux__
+        const uint32_t seq = wakeSeq.load(std::memory_order_acquire);
+        consumerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (empty()) {
+            timespec ts{ static_cast<time_t>(timeout.count() / 1000),
+                static_cast<long>((timeout.count() % 1000) * 1000000) };
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wakeSeq),
+                FUTEX_WAIT_PRIVATE, seq, &ts, nullptr, 0);
+        }
+        consumerSleeping.store(false, std::memory_order_relaxed);
+#else
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (empty() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    SpscRingStats stats() const {
+        return { pushedCount.load(std::memory_order_relaxed),
+            droppedCount.load(std::memory_order_relaxed),
+            backpressureCount.load(std::memory_order_relaxed),
+            tail.load(std::memory_order_relaxed) -
+                head.load(std::memory_order_relaxed) };
+    }
+
+    std::size_t capacity() const { return slots.size(); }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,280 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include "InstrumentRegistry.h"
+#include "TriggerIndex.h"
+#include "Types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Two copies of a record and which one (1 or 2) was last completed, 0 when
+// neither has been. A writer fills the other copy and then publishes it, so
+// a crash in the middle of a write leaves the previous state readable.
+template <typename T>
+struct Checkpoint {
+    uint32_t latest;
+    T copies[2];
+
+    const T* read() const {
+        return (latest == 0) ? nullptr : &copies[latest - 1];
+    }
+
+    // The copy not returned by read(); holds the state of two publishes ago
+    T& next() { return copies[(latest == 1) ? 1 : 0]; }
+
+    void publish() {
+        std::atomic_thread_fence(std::memory_order_release);
+        latest = (latest == 1) ? 2 : 1;
+    }
+};
+
+// Memory-mapped checkpoint of everything the strategy needs to resume a
+// session: the instrument registry, every instrument's forming bar, session
+// indicators and candle series, and the OrderManager's armed levels and open
+// positions. Owners write their records in place as they change, so a
+// restarted process maps the file and carries on without rebuilding state
+// from the feed.
+//
+// The file is a FileHeader, the registry's tokens in slot order, then one
+// Checkpoint<CandleState> and one Checkpoint<OrderState> per slot. Every
+// record has a fixed layout; a file written with a different version,
+// record size or set of timeframes, or for another session, is discarded
+// and started afresh.
+//
+// Records are only ever written by their owner: the ticker thread for the
+// tokens, a slot's candle shard for its CandleState and the OrderManager,
+// under its lock, for its OrderState. Stores land in the page cache, so
+// they survive a crash of the process but not of the machine.
+class StateStore {
+  public:
+    static constexpr uint32_t MAX_TIMEFRAMES = 8;
+    static constexpr uint32_t MAX_TRIGGERS = 2; // As armed by startOrderMonitoring
+
+    // The finest timeframe's forming bar and the day range
+    struct BarState {
+        Price open, high, low, close;
+        int64_t barStart, barEnd; // Epoch seconds
+        Price dayHigh, dayLow;
+        uint8_t flags;
+    };
+
+    struct SeriesState {
+        ScripData data;
+        uint8_t candleOpen;
+    };
+
+    struct CandleState {
+        BarState bar;
+        SessionIndicators session;
+        uint32_t seriesCount; // 0 until the first bar closed
+        SeriesState series[MAX_TIMEFRAMES];
+    };
+
+    struct OrderState {
+        Position position;
+        uint32_t triggerCount;
+        Trigger triggers[MAX_TRIGGERS];
+    };
+
+    static_assert(std::is_trivially_copyable<CandleState>::value &&
+                      std::is_trivially_copyable<OrderState>::value,
+        "records are copied straight into the mapping");
+
+  private:
+    static constexpr char MAGIC[8] = { 'T', 'R', 'D', 'S', 'T', 'A', 'T', 'E' };
+    static constexpr uint32_t VERSION = 6;
+    static constexpr std::size_t HEADER_BYTES = 4096;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t maxInstruments;
+        uint32_t candleStateSize;
+        uint32_t orderStateSize;
+        uint32_t timeframeCount;
+        uint32_t tokenCount; // Registry slots in use, see saveTokens()
+        int64_t intervals[MAX_TIMEFRAMES]; // Seconds, as CandleProcessor uses
+        int64_t session; // SessionClock::sessionOrigin of the trading day
+    };
+    static_assert(sizeof(FileHeader) <= HEADER_BYTES, "header page overflow");
+
+    // Section offsets, every section starting on a cache line
+    static constexpr std::size_t align(std::size_t bytes) {
+        return (bytes + 63) & ~std::size_t(63);
+    }
+    static constexpr std::size_t tokensOffset() { return HEADER_BYTES; }
+    static constexpr std::size_t candlesOffset() {
+        return align(tokensOffset() +
+                     InstrumentRegistry::MAX_INSTRUMENTS * sizeof(uint32_t));
+    }
+    static constexpr std::size_t ordersOffset() {
+        return align(candlesOffset() + InstrumentRegistry::MAX_INSTRUMENTS *
+                                           sizeof(Checkpoint<CandleState>));
+    }
+    static constexpr std::size_t fileBytes() {
+        return align(ordersOffset() + InstrumentRegistry::MAX_INSTRUMENTS *
+                                          sizeof(Checkpoint<OrderState>));
+    }
+
+    int fd = -1;
+    char* base = nullptr;
+    bool restored = false;
+    uint32_t savedTokens = 0;
+
+    StateStore() {} // Singleton pattern
+
+    FileHeader& header() { return *reinterpret_cast<FileHeader*>(base); }
+    uint32_t* tokens() { return reinterpret_cast<uint32_t*>(base + tokensOffset()); }
+
+    FileHeader expectedHeader(
+        const std::vector<int64_t>& intervals, int64_t session) const {
+        FileHeader expected{};
+        std::memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+        expected.version = VERSION;
+        expected.maxInstruments = InstrumentRegistry::MAX_INSTRUMENTS;
+        expected.candleStateSize = sizeof(CandleState);
+        expected.orderStateSize = sizeof(OrderState);
+        expected.timeframeCount = static_cast<uint32_t>(intervals.size());
+        for (std::size_t i = 0; i < intervals.size(); ++i) {
+            expected.intervals[i] = intervals[i];
+        }
+        expected.session = session;
+        return expected;
+    }
+
+    static bool sameLayout(const FileHeader& a, const FileHeader& b) {
+        return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 &&
+               a.version == b.version && a.maxInstruments == b.maxInstruments &&
+               a.candleStateSize == b.candleStateSize &&
+               a.orderStateSize == b.orderStateSize &&
+               a.timeframeCount == b.timeframeCount &&
+               std::memcmp(a.intervals, b.intervals, sizeof(a.intervals)) == 0 &&
+               a.tokenCount <= a.maxInstruments;
+    }
+
+  public:
+    // Never unmapped before exit: shard threads may still checkpoint while
+    // other singletons are being destroyed
+    static StateStore& getInstance() {
+        static StateStore* instance = new StateStore();
+        return *instance;
+    }
+
+    // Maps the state file at path, creating it if needed. intervals are the
+    // candle timeframes in seconds and session the SessionClock::
+    // sessionOrigin of the trading day. When the file holds state of the
+    // same layout and session, the registry is reloaded from it and
+    // wasRestored() is true; the registry must still be empty then. State of
+    // an earlier day is dropped. Returns false if the file cannot be used
+    // at all.
+    bool open(const std::string& path, const std::vector<int64_t>& intervals,
+        int64_t session) {
+        if (intervals.size() > MAX_TIMEFRAMES) {
+            return false;
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            close();
+            return false;
+        }
+
+        const FileHeader expected = expectedHeader(intervals, session);
+        FileHeader existing{};
+        bool usable =
+            static_cast<std::size_t>(info.st_size) == fileBytes() &&
+            pread(fd, &existing, sizeof(existing), 0) == sizeof(existing) &&
+            sameLayout(existing, expected) &&
+            existing.session == expected.session &&
+            InstrumentRegistry::getInstance().size() == 0;
+        // A fresh file is sparse and reads as zeros, i.e. no records
+        if (!usable && (ftruncate(fd, 0) != 0 ||
+                           ftruncate(fd, static_cast<off_t>(fileBytes())) != 0)) {
+            close();
+            return false;
+        }
+        void* address = mmap(nullptr, fileBytes(), PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = static_cast<char*>(address);
+
+        if (usable) {
+            auto& registry = InstrumentRegistry::getInstance();
+            for (uint32_t slot = 0; slot < existing.tokenCount; ++slot) {
+                if (registry.registerToken(tokens()[slot]) != slot) {
+                    // Not a registry this file could have come from; drop
+                    // every record, the mapping sees the zeroed file
+                    if (ftruncate(fd, 0) != 0 ||
+                        ftruncate(fd, static_cast<off_t>(fileBytes())) != 0) {
+                        close();
+                        return false;
+                    }
+                    usable = false;
+                    break;
+                }
+            }
+        }
+        if (!usable) {
+            header() = expected;
+        }
+        restored = usable;
+        savedTokens = header().tokenCount;
+        return true;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    bool wasRestored() const { return restored; }
+
+    // Instruments the registry held when the state was saved
+    uint32_t tokenCount() { return isOpen() ? header().tokenCount : 0; }
+
+    // Appends slots registered since the last call. Called by the ticker
+    // thread only, before any record of the new slots is written.
+    void saveTokens(const InstrumentRegistry& registry) {
+        uint32_t count = registry.size();
+        if (count == savedTokens) {
+            return;
+        }
+        for (uint32_t slot = savedTokens; slot < count; ++slot) {
+            tokens()[slot] = registry.tokenOf(slot);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        header().tokenCount = savedTokens = count;
+    }
+
+    Checkpoint<CandleState>& candles(uint32_t slot) {
+        return reinterpret_cast<Checkpoint<CandleState>*>(
+            base + candlesOffset())[slot];
+    }
+
+    Checkpoint<OrderState>& orders(uint32_t slot) {
+        return reinterpret_cast<Checkpoint<OrderState>*>(
+            base + ordersOffset())[slot];
+    }
+
+    void close() {
+        if (base != nullptr) {
+            munmap(base, fileBytes());
+            base = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+};
+
+#endif // STATE_STORE_H
@@ -0,0 +1,121 @@
+#ifndef SUBSCRIPTION_MANAGER_H
+#define SUBSCRIPTION_MANAGER_H
+
+#include "InstrumentRegistry.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Kite streaming modes, cheapest first. An ltp packet is 8 bytes, quote 44
+// and full 184 with market depth; only full carries the exchange timestamp.
+enum class TickMode : uint8_t { Ltp, Quote, Full };
+
+inline const char* tickModeName(TickMode mode) {
+    switch (mode) {
+    case TickMode::Ltp: return "ltp";
+    case TickMode::Quote: return "quote";
+    case TickMode::Full: return "full";
+    }
+    return "";
+}
+
+inline bool parseTickMode(const std::string& name, TickMode& mode) {
+    for (TickMode candidate : { TickMode::Ltp, TickMode::Quote, TickMode::Full }) {
+        if (name == tickModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The instruments the ticker streams and the mode of each. Callers say what
+// they need with add(); a token asked for in several modes streams in the
+// richest of them. subscribe() then registers every token and subscribes
+// them on the websocket in chunks, one setMode per mode and chunk, so a
+// large universe costs a handful of messages and every token only pays for
+// the packet size it needs.
+//
+// Configured before the feed starts; subscribe() is called from the
+// ticker's onConnect, again after every reconnect.
+class SubscriptionManager {
+  public:
+    static constexpr std::size_t CHUNK = 500;      // Tokens per message
+    static constexpr std::size_t MAX_TOKENS = 3000; // Kite's per-connection cap
+
+  private:
+    std::unordered_map<uint32_t, TickMode> modes;
+    std::vector<uint32_t> tokens; // In the order first added
+
+    SubscriptionManager() {} // Singleton pattern
+
+    // Kite takes tokens as int
+    template <typename Ticker>
+    static void send(Ticker& ws, TickMode mode, const std::vector<int>& group) {
+        for (std::size_t begin = 0; begin < group.size(); begin += CHUNK) {
+            std::vector<int> chunk(group.begin() + begin,
+                group.begin() + std::min(group.size(), begin + CHUNK));
+            ws.subscribe(chunk);
+            ws.setMode(tickModeName(mode), chunk);
+        }
+    }
+
+  public:
+    static SubscriptionManager& getInstance() {
+        static SubscriptionManager instance;
+        return instance;
+    }
+
+    void add(const std::vector<uint32_t>& wanted, TickMode mode) {
+        for (uint32_t token : wanted) {
+            auto inserted = modes.emplace(token, mode);
+            if (inserted.second) {
+                tokens.push_back(token);
+            } else {
+                inserted.first->second = std::max(inserted.first->second, mode);
+            }
+        }
+    }
+
+    bool contains(uint32_t token) const { return modes.count(token) != 0; }
+    std::size_t size() const { return tokens.size(); }
+    bool empty() const { return tokens.empty(); }
+
+    // Registers and subscribes every token added so far, grouped by mode.
+    // Tokens past MAX_TOKENS or the registry's capacity are left out.
+    // Returns the tokens subscribed.
+    template <typename Ticker>
+    std::size_t subscribe(Ticker& ws) {
+        auto& registry = InstrumentRegistry::getInstance();
+        std::vector<int> groups[3];
+        std::size_t subscribed = 0;
+        for (uint32_t token : tokens) {
+            if (subscribed == MAX_TOKENS ||
+                registry.registerToken(token) == InstrumentRegistry::INVALID_SLOT) {
+                continue;
+            }
+            groups[static_cast<std::size_t>(modes[token])].push_back(
+                static_cast<int>(token));
+            ++subscribed;
+        }
+        if (subscribed < tokens.size()) {
+            Logger::getInstance().log(Logger::ERROR, "Subscribing only ",
+                subscribed, " of ", tokens.size(), " instruments");
+        }
+        for (TickMode mode : { TickMode::Ltp, TickMode::Quote, TickMode::Full }) {
+            const auto& group = groups[static_cast<std::size_t>(mode)];
+            send(ws, mode, group);
+            if (!group.empty()) {
+                Logger::getInstance().log(Logger::INFO, "Subscribed ",
+                    group.size(), " instruments in ", tickModeName(mode), " mode");
+            }
+        }
+        return subscribed;
+    }
+};
+
+#endif // SUBSCRIPTION_MANAGER_H
@@ -0,0 +1,101 @@
+#ifndef TICK_BATCH_H
+#define TICK_BATCH_H
+
+#include "Types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// The fields of a kc::tick the pipeline reads, converted once on the ticker
+// thread. slot is the tick's InstrumentRegistry slot, INVALID_SLOT to skip.
+struct CompactTick {
+    uint32_t token;
+    uint32_t slot;
+    Price price;
+    int32_t quantity; // Last traded quantity
+    int64_t volume;   // Cumulative day volume, 0 where the feed has none
+    int64_t time;     // Exchange time, epoch seconds, see exchangeTime()
+};
+static_assert(sizeof(CompactTick) == 32, "two ticks per cache line");
+
+inline void compact(const kc::tick& tick, CompactTick& out) {
+    out.token = static_cast<uint32_t>(tick.instrumentToken);
+    out.price = toPrice(tick.lastPrice);
+    out.quantity = static_cast<int32_t>(tick.lastTradedQuantity);
+    out.volume = static_cast<int64_t>(tick.volumeTraded);
+    out.time = exchangeTime(tick);
+}
+
+class TickBatchPool;
+
+// One onTicks batch of compact ticks, shared read-only by every candle shard
+// it touches and the OrderManager. Each holder has a reference; the last
+// release() hands the batch back to its pool with its capacity intact.
+struct TickBatch {
+    std::vector<CompactTick> ticks;
+    int64_t received = 0; // LatencyTelemetry::now() when the batch arrived
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+    inline void release();
+
+  private:
+    friend class TickBatchPool;
+    std::atomic<uint32_t> refs{ 0 };
+    TickBatch* nextFree = nullptr;
+    TickBatchPool* pool = nullptr;
+};
+
+// Free list of TickBatches. Only one thread, the ticker thread, acquires;
+// any thread may release. With a single popper a Treiber stack is free of
+// ABA, since no batch can leave and re-enter the list while the popper
+// holds it. The pool grows when every batch is in flight and never shrinks,
+// so once the shards keep up a batch costs no allocation.
+class TickBatchPool {
+  private:
+    std::atomic<TickBatch*> freeList{ nullptr };
+    std::vector<std::unique_ptr<TickBatch>> batches; // Acquirer only
+
+  public:
+    TickBatchPool() = default;
+    TickBatchPool(const TickBatchPool&) = delete;
+    TickBatchPool& operator=(const TickBatchPool&) = delete;
+
+    // An empty batch holding one reference
+    TickBatch* acquire() {
+        TickBatch* batch = freeList.load(std::memory_order_acquire);
+        while (batch != nullptr &&
+               !freeList.compare_exchange_weak(batch, batch->nextFree,
+                   std::memory_order_acquire, std::memory_order_acquire)) {
+        }
+        if (batch == nullptr) {
+            batches.push_back(std::make_unique<TickBatch>());
+            batch = batches.back().get();
+            batch->pool = this;
+        }
+        batch->ticks.clear();
+        batch->received = 0;
+        batch->refs.store(1, std::memory_order_relaxed);
+        return batch;
+    }
+
+    void recycle(TickBatch* batch) {
+        TickBatch* head = freeList.load(std::memory_order_relaxed);
+        do {
+            batch->nextFree = head;
+        } while (!freeList.compare_exchange_weak(head, batch,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // Batches created so far
+    std::size_t size() const { return batches.size(); }
+};
+
+inline void TickBatch::release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pool->recycle(this);
+    }
+}
+
+#endif // TICK_BATCH_H
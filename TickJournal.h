@@ -0,0 +1,212 @@
+#ifndef TICK_JOURNAL_H
+#define TICK_JOURNAL_H
+
+#include "TickBatch.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary tick journal: a FileHeader followed by batches, each a BatchHeader
+// and count JournalTicks, exactly as they arrived in one onTicks callback.
+// All fields are fixed width and little endian (the host order).
+namespace TickJournal {
+
+constexpr char MAGIC[8] = { 'T', 'R', 'D', 'J', 'R', 'N', 'L', '\0' };
+constexpr uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tickSize;  // sizeof(JournalTick), guards against layout changes
+    uint64_t bytesUsed; // Valid bytes including this header
+};
+
+struct BatchHeader {
+    int64_t receiveNanos; // Wall clock when the batch reached onTicks
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct JournalTick {
+    uint32_t instrumentToken;
+    Price lastPrice;
+    int32_t lastTradedQuantity;
+    int32_t reserved;
+    int64_t volumeTraded;
+    int64_t exchangeTime; // Epoch seconds, see exchangeTime()
+};
+static_assert(sizeof(JournalTick) == 32, "journal layout is part of the file format");
+
+// Appends batches to a memory-mapped journal, growing the file in large
+// steps so appending is a memcpy in the common case. bytesUsed in the header
+// is updated after every batch, so a crash loses at most the batch in flight.
+class Writer {
+  private:
+    static constexpr std::size_t GROW_BYTES = std::size_t(64) << 20;
+
+    int fd = -1;
+    char* base = nullptr;
+    std::size_t mapped = 0;
+    std::size_t used = 0;
+
+    bool reserve(std::size_t bytes) {
+        if (used + bytes <= mapped) {
+            return true;
+        }
+        std::size_t size = mapped + std::max(GROW_BYTES, bytes);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            return false;
+        }
+        void* address = (base == nullptr)
+                            ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                            : mremap(base, mapped, size, MREMAP_MAYMOVE);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<char*>(address);
+        mapped = size;
+        return true;
+    }
+
+    FileHeader& header() { return *reinterpret_cast<FileHeader*>(base); }
+
+  public:
+    ~Writer() { close(); }
+
+    // Truncates any existing file at path
+    bool open(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || !reserve(sizeof(FileHeader))) {
+            close();
+            return false;
+        }
+        FileHeader fresh{};
+        std::memcpy(fresh.magic, MAGIC, sizeof(MAGIC));
+        fresh.version = VERSION;
+        fresh.tickSize = sizeof(JournalTick);
+        fresh.bytesUsed = sizeof(FileHeader);
+        std::memcpy(base, &fresh, sizeof(fresh));
+        used = sizeof(FileHeader);
+        return true;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+
+    void append(int64_t receiveNanos, const std::vector<CompactTick>& ticks) {
+        const std::size_t bytes =
+            sizeof(BatchHeader) + ticks.size() * sizeof(JournalTick);
+        if (!isOpen() || !reserve(bytes)) {
+            return;
+        }
+        BatchHeader batch{ receiveNanos, static_cast<uint32_t>(ticks.size()), 0 };
+        std::memcpy(base + used, &batch, sizeof(batch));
+        auto* out = reinterpret_cast<JournalTick*>(base + used + sizeof(batch));
+        for (const auto& tick : ticks) {
+            *out++ = { tick.token, tick.price, tick.quantity, 0, tick.volume,
+                tick.time };
+        }
+        used += bytes;
+        header().bytesUsed = used;
+    }
+
+    void close() {
+        if (base != nullptr) {
+            munmap(base, mapped);
+            base = nullptr;
+        }
+        if (fd >= 0) {
+            // Drop the unused tail of the last growth step
+            if (used != 0 && ftruncate(fd, static_cast<off_t>(used)) != 0) {
+                used = 0;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        mapped = used = 0;
+    }
+};
+
+// Read-only view of a journal, mapped in one go
+class Reader {
+  private:
+    int fd = -1;
+    const char* base = nullptr;
+    std::size_t mapped = 0;
+    std::size_t used = 0;
+
+  public:
+    ~Reader() {
+        if (base != nullptr) {
+            munmap(const_cast<char*>(base), mapped);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool open(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 ||
+            static_cast<std::size_t>(info.st_size) < sizeof(FileHeader)) {
+            return false;
+        }
+        mapped = static_cast<std::size_t>(info.st_size);
+        void* address = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<const char*>(address);
+        madvise(const_cast<char*>(base), mapped, MADV_SEQUENTIAL);
+
+        const auto* header = reinterpret_cast<const FileHeader*>(base);
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header->version != VERSION ||
+            header->tickSize != sizeof(JournalTick)) {
+            return false;
+        }
+        used = std::min<std::size_t>(header->bytesUsed, mapped);
+        return true;
+    }
+
+    // Receive time of the first batch, 0 when the journal has none
+    int64_t firstReceiveNanos() const {
+        if (sizeof(FileHeader) + sizeof(BatchHeader) > used) {
+            return 0;
+        }
+        BatchHeader batch;
+        std::memcpy(&batch, base + sizeof(FileHeader), sizeof(batch));
+        return batch.receiveNanos;
+    }
+
+    // Calls fn(const BatchHeader&, const JournalTick*, count) per batch
+    template <typename Fn>
+    void forEachBatch(Fn&& fn) const {
+        std::size_t offset = sizeof(FileHeader);
+        while (offset + sizeof(BatchHeader) <= used) {
+            BatchHeader batch;
+            std::memcpy(&batch, base + offset, sizeof(batch));
+            std::size_t bytes = sizeof(batch) + batch.count * sizeof(JournalTick);
+            if (offset + bytes > used) {
+                break;
+            }
+            fn(batch,
+                reinterpret_cast<const JournalTick*>(base + offset + sizeof(batch)),
+                batch.count);
+            offset += bytes;
+        }
+    }
+};
+
+} // namespace TickJournal
+
+#endif // TICK_JOURNAL_H
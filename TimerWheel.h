@@ -0,0 +1,172 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timer wheel with one-second resolution, holding at most one
+// timer per id (an InstrumentRegistry slot). Level 0 has a bucket per
+// second, level 1 per 64 seconds and level 2 per 4096 seconds; a timer sits
+// in the finest level whose span still contains both now and its deadline
+// and moves down a level as time reaches its bucket. Scheduling and
+// cancelling are O(1), and advancing costs one bucket visit per elapsed
+// second plus the timers that fire or cascade.
+//
+// Time is whatever the caller advances it with, exchange time for the
+// OrderManager, so backtests expire timers exactly as live runs do.
+class TimerWheel {
+  public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+  private:
+    static constexpr uint32_t BITS = 6;
+    static constexpr uint32_t SIZE = 1u << BITS;
+    static constexpr uint32_t MASK = SIZE - 1;
+    static constexpr uint32_t LEVELS = 3;
+
+    // Timers are intrusive nodes indexed by id, linked per bucket
+    struct Node {
+        int64_t deadline = 0;
+        uint32_t next = NONE, prev = NONE;
+        uint32_t bucket = NONE; // level * SIZE + index, NONE when idle
+    };
+
+    std::vector<Node> nodes;
+    uint32_t heads[LEVELS * SIZE];
+    int64_t now = 0;
+    std::size_t count = 0;
+
+    uint32_t bucketOf(int64_t deadline) const {
+        for (uint32_t level = 0; level + 1 < LEVELS; ++level) {
+            const uint32_t shift = BITS * (level + 1);
+            if ((deadline >> shift) == (now >> shift)) {
+                return level * SIZE +
+                       static_cast<uint32_t>((deadline >> (BITS * level)) & MASK);
+            }
+        }
+        // Anything further out waits in the top level and is placed again
+        // each time its bucket comes round
+        const uint32_t shift = BITS * (LEVELS - 1);
+        return (LEVELS - 1) * SIZE +
+               static_cast<uint32_t>((deadline >> shift) & MASK);
+    }
+
+    void link(uint32_t id) {
+        Node& node = nodes[id];
+        node.bucket = bucketOf(node.deadline);
+        node.prev = NONE;
+        node.next = heads[node.bucket];
+        if (node.next != NONE) {
+            nodes[node.next].prev = id;
+        }
+        heads[node.bucket] = id;
+    }
+
+    void unlink(uint32_t id) {
+        Node& node = nodes[id];
+        if (node.prev != NONE) {
+            nodes[node.prev].next = node.next;
+        } else {
+            heads[node.bucket] = node.next;
+        }
+        if (node.next != NONE) {
+            nodes[node.next].prev = node.prev;
+        }
+        node.bucket = NONE;
+    }
+
+    // Jumps straight to time, e.g. on the first advance after timers were
+    // restored: fires what is due and places the rest again
+    template <typename Fire>
+    void jump(int64_t time, Fire& fire) {
+        std::vector<uint32_t> pending, due;
+        for (uint32_t id = 0; id < nodes.size(); ++id) {
+            if (nodes[id].bucket != NONE) {
+                unlink(id);
+                pending.push_back(id);
+            }
+        }
+        now = time;
+        for (uint32_t id : pending) {
+            if (nodes[id].deadline <= now) {
+                --count;
+                due.push_back(id);
+            } else {
+                link(id);
+            }
+        }
+        for (uint32_t id : due) {
+            fire(id);
+        }
+    }
+
+    // Detaches bucket and places its timers again against the current now
+    void cascade(uint32_t bucket) {
+        uint32_t id = heads[bucket];
+        heads[bucket] = NONE;
+        while (id != NONE) {
+            const uint32_t next = nodes[id].next;
+            link(id);
+            id = next;
+        }
+    }
+
+  public:
+    explicit TimerWheel(std::size_t ids) : nodes(ids) {
+        for (auto& head : heads) {
+            head = NONE;
+        }
+    }
+
+    bool empty() const { return count == 0; }
+    bool scheduled(uint32_t id) const { return nodes[id].bucket != NONE; }
+
+    // Fires id on the first advance() past deadline (epoch seconds),
+    // replacing any timer id had
+    void schedule(uint32_t id, int64_t deadline) {
+        cancel(id);
+        nodes[id].deadline = (deadline > now) ? deadline : now + 1;
+        link(id);
+        ++count;
+    }
+
+    void cancel(uint32_t id) {
+        if (nodes[id].bucket != NONE) {
+            unlink(id);
+            --count;
+        }
+    }
+
+    // Moves time forward to time, calling fire(id) for every timer whose
+    // deadline is at or before it. fire may schedule and cancel timers.
+    template <typename Fire>
+    void advance(int64_t time, Fire&& fire) {
+        if (count == 0) {
+            now = (time > now) ? time : now;
+            return;
+        }
+        if (time - now > int64_t(SIZE) * SIZE * SIZE) {
+            jump(time, fire);
+            return;
+        }
+        while (now < time && count != 0) {
+            ++now;
+            for (uint32_t level = LEVELS - 1; level > 0; --level) {
+                if ((now & ((int64_t(1) << (BITS * level)) - 1)) == 0) {
+                    cascade(level * SIZE + static_cast<uint32_t>(
+                                               (now >> (BITS * level)) & MASK));
+                }
+            }
+            const uint32_t bucket = static_cast<uint32_t>(now & MASK);
+            while (heads[bucket] != NONE) {
+                const uint32_t id = heads[bucket];
+                unlink(id);
+                --count;
+                fire(id);
+            }
+        }
+        now = (time > now) ? time : now;
+    }
+};
+
+#endif // TIMER_WHEEL_H
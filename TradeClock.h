@@ -0,0 +1,37 @@
+#ifndef TRADE_CLOCK_H
+#define TRADE_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Wall clock used by the trading pipeline. Live it is system_clock; during a
+// journal replay the replay driver sets it to the recorded time of each
+// batch, so time-based logic sees the session's clock rather than the
+// machine's.
+namespace TradeClock {
+
+inline std::atomic<int64_t>& simulatedNanos() {
+    static std::atomic<int64_t> nanos{ 0 }; // 0 means live
+    return nanos;
+}
+
+inline std::chrono::system_clock::time_point now() {
+    int64_t nanos = simulatedNanos().load(std::memory_order_relaxed);
+    if (nanos == 0) {
+        return std::chrono::system_clock::now();
+    }
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(nanos)));
+}
+
+inline void setSimulated(int64_t epochNanos) {
+    simulatedNanos().store(epochNanos, std::memory_order_relaxed);
+}
+
+inline void setLive() { setSimulated(0); }
+
+} // namespace TradeClock
+
+#endif // TRADE_CLOCK_H
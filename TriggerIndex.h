@@ -0,0 +1,123 @@
+#ifndef TRIGGER_INDEX_H
+#define TRIGGER_INDEX_H
+
+#include "Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// A price level armed for one instrument. Above triggers fire when the price
+// trades through the level from below, Below triggers when it trades under it.
+struct Trigger {
+    enum Side : uint8_t { Above, Below };
+    enum Action : uint8_t { EnterCall, EnterPut };
+
+    Price level;
+    Side side;
+    Action action;
+    Price stopLoss; // Exit level handed to the position once the entry fills
+};
+
+struct FiredTrigger {
+    uint32_t slot;    // InstrumentRegistry slot
+    Price price;      // Price of the tick that crossed the level
+    int64_t tickTime; // Exchange time of that tick, epoch seconds
+    Trigger trigger;
+};
+
+// An entry that has filled and not been exited yet
+struct Position {
+    bool open = false;
+    Trigger::Action side = Trigger::EnterCall;
+    Price entryPrice = 0;
+    Price stopLoss = 0;
+    int64_t entryTime = 0; // Exchange time, epoch seconds
+    int64_t trailFrom = 0; // Candles ending at or after this trail the stop
+    int64_t exitBy = 0;    // Time-based exit, exchange time; 0 for none
+    uint32_t contract = 0; // Option token traded, 0 when none was resolved
+    Price contractEntry = 0; // Last price of contract at entry, 0 if unknown
+};
+
+// TriggerIndex keeps the armed levels of every instrument sorted by price,
+// indexed by InstrumentRegistry slot. Each side is stored with the level
+// closest to the market at the back, so a tick costs one comparison per side
+// unless something fires.
+class TriggerIndex {
+  private:
+    struct Book {
+        std::vector<Trigger> above; // Descending, lowest level at the back
+        std::vector<Trigger> below; // Ascending, highest level at the back
+    };
+    std::vector<Book> books;
+    std::size_t armedCount = 0;
+
+  public:
+    explicit TriggerIndex(std::size_t slots) : books(slots) {}
+
+    void arm(uint32_t slot, const Trigger& trigger) {
+        auto& book = books[slot];
+        if (trigger.side == Trigger::Above) {
+            auto pos = std::upper_bound(book.above.begin(), book.above.end(),
+                trigger, [](const Trigger& a, const Trigger& b) {
+                    return a.level > b.level;
+                });
+            book.above.insert(pos, trigger);
+        } else {
+            auto pos = std::upper_bound(book.below.begin(), book.below.end(),
+                trigger, [](const Trigger& a, const Trigger& b) {
+                    return a.level < b.level;
+                });
+            book.below.insert(pos, trigger);
+        }
+        ++armedCount;
+    }
+
+    void disarm(uint32_t slot) {
+        auto& book = books[slot];
+        armedCount -= book.above.size() + book.below.size();
+        // Keep the capacity around, the instrument is likely to be armed
+        // again later in the session.
+        book.above.clear();
+        book.below.clear();
+    }
+
+    // Removes every trigger crossed by lastPrice and appends it to fired.
+    void collect(uint32_t slot, Price lastPrice, int64_t tickTime,
+        std::vector<FiredTrigger>& fired) {
+        if (armedCount == 0) {
+            return;
+        }
+        auto& book = books[slot];
+        while (!book.above.empty() && lastPrice > book.above.back().level) {
+            fired.push_back(
+                { slot, lastPrice, tickTime, book.above.back() });
+            book.above.pop_back();
+            --armedCount;
+        }
+        while (!book.below.empty() && lastPrice < book.below.back().level) {
+            fired.push_back(
+                { slot, lastPrice, tickTime, book.below.back() });
+            book.below.pop_back();
+            --armedCount;
+        }
+    }
+
+    // Copies up to max triggers armed for slot into out, returns how many
+    std::size_t copyArmed(uint32_t slot, Trigger* out, std::size_t max) const {
+        const auto& book = books[slot];
+        std::size_t n = 0;
+        for (const auto* side : { &book.above, &book.below }) {
+            for (const auto& trigger : *side) {
+                if (n < max) {
+                    out[n++] = trigger;
+                }
+            }
+        }
+        return n;
+    }
+
+    std::size_t size() const { return armedCount; }
+};
+
+#endif // TRIGGER_INDEX_H
@@ -1,36 +1,124 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include "CandleHistory.h"
+#include "Indicators.h"
+#include "TradeClock.h"
 #include "kitepp.hpp"
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
 #include <vector>
 #include <chrono>
 namespace kc = kiteconnect;
 
-// Structure to store 15-minute candle data
-struct Candle {
-    double open;
-    double high;
-    double low;
-    double close;
-    std::string color; // Green or Red
-    std::chrono::time_point<std::chrono::system_clock> startTime;
-    std::chrono::time_point<std::chrono::system_clock> endTime;
+// Prices are held as integer ticks of one paisa, so candle comparisons are
+// exact and a Candle fits in a cache line
+using Price = int32_t;
+constexpr double PRICE_SCALE = 100.0;
+
+inline Price toPrice(double rupees) {
+    return static_cast<Price>(std::llround(rupees * PRICE_SCALE));
+}
+inline double toRupees(Price price) { return price / PRICE_SCALE; }
+
+// Flat marks a bar filled in for an interval without ticks; it never
+// takes part in a pattern
+enum class CandleColor : uint8_t { Green, Red, Flat };
+
+inline const char* colorName(CandleColor color) {
+    switch (color) {
+    case CandleColor::Green: return "Green";
+    case CandleColor::Red: return "Red";
+    case CandleColor::Flat: return "Flat";
+    }
+    return "";
+}
+
+// Number of closed candles kept per timeframe, fixed at compile time
+#ifndef CANDLE_HISTORY_DEPTH
+#define CANDLE_HISTORY_DEPTH 2
+#endif
+
+// Structure to store candle data for one timeframe
+struct alignas(64) Candle {
+    Price open;
+    Price high;
+    Price low;
+    Price close;
+    int64_t startTime; // Epoch seconds
+    int64_t endTime;
     double bodyRatio{0};
     double wickRatio{0};
     double candleToIndexRatio{0};
+    CandleColor color = CandleColor::Green;
 };
+static_assert(sizeof(Candle) == 64, "Candle should fill one cache line");
+static_assert(std::is_trivially_copyable<Candle>::value,
+    "Candle is copied by value into snapshots");
+
 // Structure to track day-high and day-low for each scrip (reused)
 struct ScripData {
-    std::vector<Candle> candles; // To store the last 2 candles
-    double dayHigh;
-    double dayLow;
+    CandleHistory<Candle, CANDLE_HISTORY_DEPTH> candles; // Last closed candles
+    Price dayHigh;
+    Price dayLow;
     bool DayLowReversalIdentified = false;
     bool DayHighReversalIdentified = false;
-    double signalCandleHigh = 0.0; // Price to monitor for placing a buy order
-    double signalCandleLow = 0.0;
-    bool orderPlaced = false; // Track if an order is placed
+    Price signalCandleHigh = 0; // Price to monitor for placing a buy order
+    Price signalCandleLow = 0;
+    int intervalMinutes = 15; // Timeframe of the candles above
+    uint32_t signals = 0;     // PatternBit mask of the last closed candle
+    IndicatorSet indicators;  // As of the last closed candle
+};
+static_assert(std::is_trivially_copyable<ScripData>::value,
+    "ScripData is copied without touching the heap");
+
+// Tunable knobs of the day-high/day-low reversal strategy. The defaults are
+// the values the strategy has always traded with.
+struct StrategyParams {
+    // A candle within this percentage of the day low/high counts as touching it
+    double proximityPercent = 0.1;
+    // Timeframe whose candles drive signals and the trailing stop
+    int tradeIntervalMinutes = 15;
+    // The stop starts trailing once this many trade-timeframe candles,
+    // counted from the start of the entry candle, have closed
+    int trailAfterCandles = 2;
+    // Length of the opening range, from the session open
+    int openingRangeMinutes = 15;
+    // Option contracts bought per entry
+    int orderQuantity = 75;
+    // Strikes out of the money from the at-the-money option to trade,
+    // negative for in the money (see OptionChains::resolve)
+    int optionStrikesAway = 0;
+    // Positions are closed after this many minutes, 0 holds them until the
+    // stop is hit
+    int maxHoldMinutes = 0;
+    // Minutes after the session open at which every position is closed,
+    // e.g. 360 for 15:15 IST; 0 never squares off
+    int squareOffMinutes = 0;
+    // Entries are skipped while the instrument's spread is wider than this
+    // many basis points of its microprice; 0 never skips on spread
+    double maxSpreadBps = 0;
+    // Entries are skipped while the depth imbalance (see L2Book) leans
+    // against them by more than this: a call below -x, a put above x.
+    // 1 never skips. Both filters only apply where a book is streamed.
+    double maxAdverseImbalance = 1;
 };
 
+// Exchange timestamp of a tick in epoch seconds. Only "full" mode ticks carry
+// the exchange timestamp, so fall back to the last trade time and finally to
+// the local clock.
+inline int64_t exchangeTime(const kc::tick& tick) {
+    if (tick.timestamp > 0) {
+        return tick.timestamp;
+    }
+    if (tick.lastTradeTime > 0) {
+        return tick.lastTradeTime;
+    }
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        TradeClock::now().time_since_epoch())
+        .count();
+}
 
-#endif // TYPES_H
\ No newline at end of file
+#endif // TYPES_H
@@ -0,0 +1,86 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers, each with its own job deque. A worker pops from the
+// back of its own deque and, once that runs dry, steals from the front of the
+// others, so long and short jobs even out without a shared queue. Meant for
+// coarse jobs such as whole backtest runs: each deque has its own small lock.
+class WorkStealingPool {
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<std::size_t> nextQueue{ 0 };
+
+    bool pop(std::size_t self, std::function<void()>& job) {
+        {
+            Queue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+  public:
+    // threads 0 uses every hardware thread
+    explicit WorkStealingPool(std::size_t threads = 0) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+    }
+
+    std::size_t size() const { return queues.size(); }
+
+    // Jobs are dealt round-robin; must not be called while run() is active
+    void submit(std::function<void()> job) {
+        Queue& queue = *queues[nextQueue++ % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    // Runs every submitted job and returns once all of them have finished
+    void run() {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < queues.size(); ++i) {
+            workers.emplace_back([this, i] {
+                std::function<void()> job;
+                while (pop(i, job)) {
+                    job();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+};
+
+#endif // WORK_STEALING_POOL_H
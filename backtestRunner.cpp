@@ -0,0 +1,230 @@
+#include "InstrumentRegistry.h"
+#include "Logger.h"
+#include "TickJournal.h"
+#include "Types.h"
+#include "WorkStealingPool.h"
+#include "candleProcessor.cpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+// Offline backtest and parameter sweep. Every combination of strategy
+// parameters is replayed over every recorded tick journal; each (journal,
+// parameters) pair is an independent run with its own CandleProcessor,
+// PatternDetector and OrderManager, scheduled on a work-stealing pool.
+//
+// Usage: backtest <sweep.json>
+//   {
+//     "journals": ["2024-01-01.jrnl", "2024-01-02.jrnl"],
+//     "proximity_percent": [0.05, 0.1, 0.2],
+//     "trade_timeframe": [5, 15],
+//     "trail_after_candles": [1, 2, 3],
+//     "threads": 0,                      // optional, 0 = all cores
+//     "results": "backtest_runs.tsv"     // optional per-run table
+//   }
+
+struct BacktestRun {
+    std::string journal;
+    StrategyParams params;
+    std::vector<int64_t> tradePnl; // Paise per closed trade, in exit order
+    bool ok = false;
+};
+
+struct BacktestStats {
+    std::size_t trades = 0;
+    std::size_t wins = 0;
+    int64_t pnl = 0;         // Paise
+    int64_t maxDrawdown = 0; // Largest peak-to-trough fall of cumulative P&L
+
+    void add(int64_t tradePnl) {
+        ++trades;
+        wins += (tradePnl > 0);
+        pnl += tradePnl;
+        peak = std::max(peak, pnl);
+        maxDrawdown = std::max(maxDrawdown, peak - pnl);
+    }
+
+    double hitRate() const { return trades ? 100.0 * wins / trades : 0; }
+
+  private:
+    int64_t peak = 0;
+};
+
+// Replays one journal straight through the candle and order logic on the
+// calling thread. Slots must already be registered for every token in it.
+void runBacktest(BacktestRun& run) {
+    TickJournal::Reader reader;
+    if (!reader.open(run.journal)) {
+        return;
+    }
+    OrderManager orders(run.params);
+    CandleProcessor candles(0, 1, { run.params.tradeIntervalMinutes }, orders);
+
+    auto& registry = InstrumentRegistry::getInstance();
+    std::vector<CompactTick> ticks;
+    int64_t lastTime = 0;
+    reader.forEachBatch([&](const TickJournal::BatchHeader&,
+                            const TickJournal::JournalTick* recorded,
+                            uint32_t count) {
+        ticks.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            CompactTick& tick = ticks[i];
+            tick.token = recorded[i].instrumentToken;
+            tick.slot = registry.slotOf(recorded[i].instrumentToken);
+            tick.price = recorded[i].lastPrice;
+            tick.quantity = recorded[i].lastTradedQuantity;
+            tick.volume = recorded[i].volumeTraded;
+            tick.time = recorded[i].exchangeTime;
+            if (tick.slot != InstrumentRegistry::INVALID_SLOT) {
+                candles.updateCandle(
+                    tick.slot, tick.price, tick.time, tick.volume);
+            }
+            lastTime = std::max(lastTime, tick.time);
+        }
+        candles.flushPatterns();
+        orders.updateTickData(ticks);
+    });
+    orders.closeOpenPositions(lastTime);
+
+    for (const auto& trade : orders.closedTrades()) {
+        run.tradePnl.push_back(trade.pnl());
+    }
+    run.ok = true;
+}
+
+template <typename T>
+std::vector<T> sweepValues(const nlohmann::json& config, const char* key, T fallback) {
+    if (!config.contains(key)) {
+        return { fallback };
+    }
+    if (config[key].is_array()) {
+        return config[key].get<std::vector<T>>();
+    }
+    return { config[key].get<T>() };
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <sweep.json>" << std::endl;
+        return 1;
+    }
+    std::ifstream file(argv[1]);
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+    nlohmann::json config;
+    file >> config;
+
+    // Runs log only errors; a sweep would otherwise write millions of lines
+    Logger::getInstance().setLogLevel(Logger::ERROR);
+
+    auto journals = config.value("journals", std::vector<std::string>{});
+    StrategyParams defaults;
+    auto proximities =
+        sweepValues(config, "proximity_percent", defaults.proximityPercent);
+    auto timeframes =
+        sweepValues(config, "trade_timeframe", defaults.tradeIntervalMinutes);
+    auto trails =
+        sweepValues(config, "trail_after_candles", defaults.trailAfterCandles);
+
+    // Registration is not thread safe, so every token is given its slot here
+    // before the runs start and only looked up by them
+    for (const auto& journal : journals) {
+        TickJournal::Reader reader;
+        if (!reader.open(journal)) {
+            std::cerr << "Could not read tick journal " << journal << std::endl;
+            return 1;
+        }
+        reader.forEachBatch([](const TickJournal::BatchHeader&,
+                                const TickJournal::JournalTick* recorded,
+                                uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                InstrumentRegistry::getInstance().registerToken(
+                    recorded[i].instrumentToken);
+            }
+        });
+    }
+
+    // runs[config * journals.size() + journal]
+    std::vector<StrategyParams> configs;
+    for (double proximity : proximities) {
+        for (int timeframe : timeframes) {
+            for (int trail : trails) {
+                configs.push_back({ proximity, timeframe, trail });
+            }
+        }
+    }
+    std::vector<BacktestRun> runs(configs.size() * journals.size());
+    WorkStealingPool pool(config.value("threads", 0));
+    for (std::size_t c = 0; c < configs.size(); ++c) {
+        for (std::size_t j = 0; j < journals.size(); ++j) {
+            BacktestRun& run = runs[c * journals.size() + j];
+            run.journal = journals[j];
+            run.params = configs[c];
+            pool.submit([&run] { runBacktest(run); });
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    pool.run();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    auto writeRow = [](std::ostream& out, const StrategyParams& params,
+                        const BacktestStats& stats) {
+        out << params.proximityPercent << '\t' << params.tradeIntervalMinutes
+            << '\t' << params.trailAfterCandles << '\t' << stats.trades << '\t'
+            << stats.wins << '\t' << stats.hitRate() << '\t'
+            << stats.pnl / PRICE_SCALE << '\t'
+            << stats.maxDrawdown / PRICE_SCALE << '\n';
+    };
+    const char* columns = "proximity_percent\ttrade_timeframe\t"
+                          "trail_after_candles\ttrades\twins\thit_rate\tpnl\t"
+                          "max_drawdown\n";
+
+    // Per run: one row per (journal, parameters)
+    std::string resultsPath = config.value("results", "");
+    if (!resultsPath.empty()) {
+        std::ofstream results(resultsPath);
+        results << std::fixed << std::setprecision(2) << "journal\t" << columns;
+        for (const auto& run : runs) {
+            BacktestStats stats;
+            for (int64_t pnl : run.tradePnl) {
+                stats.add(pnl);
+            }
+            results << run.journal << '\t';
+            writeRow(results, run.params, stats);
+        }
+    }
+
+    // Per parameter set: every journal in the order given, best P&L first
+    std::vector<std::pair<StrategyParams, BacktestStats>> summary;
+    for (std::size_t c = 0; c < configs.size(); ++c) {
+        BacktestStats stats;
+        for (std::size_t j = 0; j < journals.size(); ++j) {
+            const BacktestRun& run = runs[c * journals.size() + j];
+            if (!run.ok) {
+                std::cerr << "Run failed: " << run.journal << std::endl;
+            }
+            for (int64_t pnl : run.tradePnl) {
+                stats.add(pnl);
+            }
+        }
+        summary.emplace_back(configs[c], stats);
+    }
+    std::stable_sort(summary.begin(), summary.end(),
+        [](const auto& a, const auto& b) { return a.second.pnl > b.second.pnl; });
+
+    std::cout << std::fixed << std::setprecision(2) << columns;
+    for (const auto& entry : summary) {
+        writeRow(std::cout, entry.first, entry.second);
+    }
+    std::cerr << runs.size() << " runs on " << pool.size() << " threads in "
+              << elapsed.count() << " ms" << std::endl;
+    return 0;
+}
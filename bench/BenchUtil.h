@@ -0,0 +1,96 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Shared timing and reporting for the benchmark executables. Every result is
+// printed to stdout as one JSON object per line, so runs of two versions can
+// be diffed or loaded side by side; a readable summary goes to stderr.
+namespace bench {
+
+inline int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Keeps the optimiser from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Latency samples in nanoseconds
+class Samples {
+  private:
+    std::vector<double> values;
+    bool sorted = false;
+
+  public:
+    void reserve(std::size_t n) { values.reserve(n); }
+
+    void add(double nanos) {
+        values.push_back(nanos);
+        sorted = false;
+    }
+
+    std::size_t size() const { return values.size(); }
+
+    double percentile(double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        if (!sorted) {
+            std::sort(values.begin(), values.end());
+            sorted = true;
+        }
+        std::size_t index = static_cast<std::size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    }
+};
+
+// params is a preformatted list of extra JSON members, e.g. "\"batch\":2"
+inline void report(const std::string& name, const std::string& params,
+    uint64_t ops, int64_t elapsedNanos, Samples& latency) {
+    double seconds = elapsedNanos / 1e9;
+    double opsPerSec = seconds > 0 ? ops / seconds : 0;
+    double p50 = latency.percentile(50), p99 = latency.percentile(99),
+           p999 = latency.percentile(99.9);
+    std::printf("{\"benchmark\":\"%s\"%s%s,\"ops\":%llu,\"seconds\":%.6f,"
+                "\"ops_per_sec\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,"
+                "\"p999_ns\":%.1f}\n",
+        name.c_str(), params.empty() ? "" : ",", params.c_str(),
+        static_cast<unsigned long long>(ops), seconds, opsPerSec, p50, p99, p999);
+    std::fflush(stdout);
+    std::fprintf(stderr, "%-32s %-28s %12.0f ops/s  p50 %9.1f ns  p99 %9.1f ns  p99.9 %9.1f ns\n",
+        name.c_str(), params.c_str(), opsPerSec, p50, p99, p999);
+}
+
+// Runs op(i) for i in [0, samples * opsPerSample) and times every group of
+// opsPerSample calls, so the per-op latency of very cheap operations is not
+// swamped by the cost of reading the clock
+template <typename Op>
+void run(const std::string& name, const std::string& params,
+    std::size_t samples, std::size_t opsPerSample, Op&& op) {
+    Samples latency;
+    latency.reserve(samples);
+    uint64_t i = 0;
+    int64_t start = nowNanos();
+    for (std::size_t s = 0; s < samples; ++s) {
+        int64_t begin = nowNanos();
+        for (std::size_t k = 0; k < opsPerSample; ++k) {
+            op(i++);
+        }
+        latency.add(double(nowNanos() - begin) / opsPerSample);
+    }
+    report(name, params, i, nowNanos() - start, latency);
+}
+
+} // namespace bench
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,288 @@
+#include "BenchUtil.h"
+#include "InstrumentRegistry.h"
+#include "Logger.h"
+#include "Types.h"
+#include "candleProcessor.cpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Microbenchmarks of the per-tick and per-bar hot paths.
+//
+// Usage: microBench [name filter]
+// Each component runs on its own instances with logging limited to errors,
+// except the logger cases, which log at DEBUG to trade_data.log.
+
+namespace {
+
+constexpr int64_t SESSION_OPEN = 1704080700; // 09:15 IST, 1 Jan 2024
+constexpr std::size_t SAMPLES = 2000;
+
+std::vector<uint32_t> registerSlots(uint32_t count) {
+    std::vector<uint32_t> slots;
+    for (uint32_t token = 1; token <= count; ++token) {
+        slots.push_back(InstrumentRegistry::getInstance().registerToken(token));
+    }
+    return slots;
+}
+
+// Deterministic price wiggle around 215 rupees
+Price priceAt(uint64_t i) {
+    return toPrice(21500) + static_cast<Price>((i * 2654435761u) % 4001) - 2000;
+}
+
+void benchCandles() {
+    const uint32_t instruments = 256;
+    auto slots = registerSlots(instruments);
+    {
+        // One tick per instrument per second: mostly in-bar updates, with a
+        // 1m close (and its roll-ups) every 60 rounds
+        OrderManager orders;
+        CandleProcessor candles(0, 1, DEFAULT_TIMEFRAMES, orders);
+        bench::run("candle.updateCandle", "\"instruments\":256", SAMPLES, 256,
+            [&](uint64_t i) {
+                candles.updateCandle(slots[i % instruments], priceAt(i),
+                    SESSION_OPEN + int64_t(i / instruments));
+            });
+    }
+    {
+        // Every round of ticks lands a minute after the previous one, so its
+        // first tick closes the 1m candle of every instrument in one batch,
+        // rolls them into 3/5/15/60m and runs pattern detection on the closes
+        OrderManager orders;
+        CandleProcessor candles(0, 1, DEFAULT_TIMEFRAMES, orders);
+        bench::run("candle.finalizeCandle", "\"instruments\":256", SAMPLES, 16,
+            [&](uint64_t i) {
+                candles.updateCandle(slots[i % instruments], priceAt(i),
+                    SESSION_OPEN + int64_t(i / instruments) * 60);
+                candles.flushPatterns();
+            });
+    }
+}
+
+void benchPattern() {
+    for (uint32_t instruments : { 2u, 256u, 1024u }) {
+        auto slots = registerSlots(instruments);
+        OrderManager orders;
+        PatternDetector detector(orders);
+        detector.resize(instruments, 1);
+
+        // Alternating red/green pairs near the day range, so the reversal,
+        // engulfing and inside bar patterns fire on a share of the rows
+        std::vector<ScripData> data(instruments);
+        for (uint32_t r = 0; r < instruments; ++r) {
+            Price base = priceAt(r);
+            data[r].intervalMinutes = 1; // Signals log but arm no entries
+            data[r].dayHigh = base + 2000;
+            data[r].dayLow = base - 2000;
+            data[r].candles.push_back({ base + 500, base + 600, base - 1990,
+                base - 1500, SESSION_OPEN, SESSION_OPEN + 900 });
+            data[r].candles.push_back({ base - 1600 + Price(r % 3) * 800,
+                base + 400, base - 2000, base + 300, SESSION_OPEN + 900,
+                SESSION_OPEN + 1800 });
+            // Range and VWAP inside the second candle, so the breakout and
+            // VWAP patterns see crossings too
+            data[r].indicators.vwap = base - 1000;
+            data[r].indicators.rangeHigh = base - 800;
+            data[r].indicators.rangeLow = base - 1800;
+            data[r].indicators.rangeReady = true;
+        }
+
+        // One op stages every instrument and evaluates the batch
+        bench::run("pattern.evaluate",
+            "\"instruments\":" + std::to_string(instruments), SAMPLES / 4, 1,
+            [&](uint64_t) {
+                for (uint32_t r = 0; r < instruments; ++r) {
+                    detector.stage(0, slots[r], r, data[r], 0);
+                }
+                detector.flush();
+            });
+    }
+}
+
+void benchIndicators() {
+    {
+        // The per-tick VWAP and opening range update of one instrument
+        SessionIndicators session;
+        session.start(SESSION_OPEN, 900);
+        bench::run("indicators.onTick", "", SAMPLES, 256, [&](uint64_t i) {
+            session.onTick(priceAt(i), int64_t(i) * 10,
+                SESSION_OPEN + int64_t(i / 64));
+            bench::doNotOptimize(session);
+        });
+    }
+    {
+        // Every per-candle indicator of one series
+        IndicatorSet indicators;
+        bench::run("indicators.close", "", SAMPLES, 256, [&](uint64_t i) {
+            Price close = priceAt(i);
+            indicators.addVolume(int64_t(i % 1000));
+            bench::doNotOptimize(
+                indicators.close(close + 300, close - 300, close));
+            bench::doNotOptimize(indicators);
+        });
+    }
+}
+
+void benchOrders() {
+    for (uint32_t batch : { 2u, 256u }) {
+        auto slots = registerSlots(batch);
+        OrderManager orders;
+        // Half the instruments have entry levels armed well away from price
+        for (uint32_t i = 0; i < batch; i += 2) {
+            orders.startOrderMonitoring(slots[i], toPrice(30000), toPrice(10000));
+        }
+        std::vector<CompactTick> ticks(batch);
+        for (uint32_t i = 0; i < batch; ++i) {
+            ticks[i].token = InstrumentRegistry::getInstance().tokenOf(slots[i]);
+            ticks[i].slot = slots[i];
+            ticks[i].time = SESSION_OPEN;
+        }
+        bench::run("orders.updateTickData",
+            "\"batch\":" + std::to_string(batch), SAMPLES, 16, [&](uint64_t i) {
+                ticks[i % batch].price = priceAt(i);
+                orders.updateTickData(ticks);
+            });
+    }
+}
+
+// A bar close publishing the trade-timeframe candles and an order-side
+// reader taking a consistent copy of them
+void benchSnapshots() {
+    auto slots = registerSlots(256);
+    OrderManager orders;
+    ScripData data;
+    data.intervalMinutes = orders.strategy().tradeIntervalMinutes;
+    data.candles.push_back(Candle{});
+    bench::run("orders.updateCandleData", "", SAMPLES, 256, [&](uint64_t i) {
+        data.candles.back().close = priceAt(i);
+        orders.updateCandleData(slots[i % 256], data);
+    });
+    ScripData snapshot;
+    bench::run("orders.candleSnapshot", "", SAMPLES, 256, [&](uint64_t i) {
+        bench::doNotOptimize(orders.candleSnapshot(slots[i % 256], snapshot));
+        bench::doNotOptimize(snapshot);
+    });
+}
+
+// A full-mode tick's five levels a side into its instrument's L2Book
+void benchBook() {
+    auto slots = registerSlots(256);
+    kc::tick tick;
+    tick.marketDepth.buy.resize(L2Book::LEVELS);
+    tick.marketDepth.sell.resize(L2Book::LEVELS);
+    for (int i = 0; i < L2Book::LEVELS; ++i) {
+        tick.marketDepth.buy[i] = { int16_t(3 + i), 215.0 - 0.05 * i, 75 * (i + 1) };
+        tick.marketDepth.sell[i] = { int16_t(2 + i), 215.05 + 0.05 * i, 50 * (i + 1) };
+    }
+    auto& books = OrderBooks::getInstance();
+    bench::run("book.update", "", SAMPLES, 256, [&](uint64_t i) {
+        tick.marketDepth.buy[0].quantity = int32_t(i % 500) + 1;
+        books.update(slots[i % 256], tick, SESSION_OPEN);
+    });
+    L2Book book;
+    bench::run("book.read", "", SAMPLES, 256, [&](uint64_t i) {
+        bench::doNotOptimize(books.read(slots[i % 256], book));
+        bench::doNotOptimize(book);
+    });
+}
+
+// An entry through every pre-trade check with every limit on, and its exit
+// giving the exposure back
+void benchRisk() {
+    auto slots = registerSlots(256);
+    RiskEngine risk;
+    risk.setLimits({ 750, 64, 100, 50000, 60 });
+    bench::run("risk.admit", "", SAMPLES, 256, [&](uint64_t i) {
+        const uint32_t slot = slots[i % 256];
+        const int64_t time = SESSION_OPEN + int64_t(i);
+        bench::doNotOptimize(risk.admit(slot, Trigger::EnterCall, 75, time));
+        risk.exited(slot, 75, 0, time);
+    });
+}
+
+// Submit to fill through the gateway's I/O thread against an instant mock
+// exchange without a rate limit, so only the queues and thread handoff count
+void benchGateway() {
+    MockExchange::Config exchange;
+    exchange.latencyMicros = 0;
+    exchange.jitterMicros = 0;
+    exchange.fillDelayMicros = 0;
+    exchange.retryRate = 0;
+    OrderGateway::Config config;
+    config.ordersPerSecond = 1e12;
+    config.burst = 1e6;
+    config.maxBatch = 64;
+    OrderGateway gateway(std::make_unique<MockExchange>(exchange), config);
+    gateway.start();
+
+    for (uint32_t batch : { 1u, 16u }) {
+        bench::run("gateway.roundTrip", "\"batch\":" + std::to_string(batch),
+            SAMPLES / 4, batch, [&](uint64_t i) {
+                if (i % batch != 0) {
+                    return;
+                }
+                for (uint32_t b = 0; b < batch; ++b) {
+                    gateway.submit({ i + b, 0, 1, OrderIntent::Buy,
+                        Trigger::EnterCall, 1, priceAt(i), priceAt(i), 0, 0 });
+                }
+                for (uint32_t filled = 0; filled < batch;) {
+                    gateway.drainEvents([&filled](const OrderEvent& event) {
+                        filled += event.type == OrderEvent::Fill;
+                    });
+                    std::this_thread::yield();
+                }
+            });
+    }
+    gateway.stop();
+}
+
+void benchLogger() {
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(Logger::DEBUG);
+    bench::run("logger.log", "", SAMPLES / 4, 16, [&](uint64_t i) {
+        logger.log(Logger::DEBUG, "Tick ", i, " price ", toRupees(priceAt(i)));
+    });
+    bench::run("logger.logFast", "", SAMPLES / 4, 16, [&](uint64_t i) {
+        LOG_FAST(DEBUG, "Tick ", i, " price ", toRupees(priceAt(i)));
+    });
+    logger.setLogLevel(Logger::ERROR);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* filter = (argc > 1) ? argv[1] : "";
+    auto selected = [filter](const char* name) {
+        return std::strstr(name, filter) != nullptr;
+    };
+
+    Logger::getInstance().setLogLevel(Logger::ERROR);
+    if (selected("candle")) {
+        benchCandles();
+    }
+    if (selected("pattern")) {
+        benchPattern();
+    }
+    if (selected("indicators")) {
+        benchIndicators();
+    }
+    if (selected("orders")) {
+        benchOrders();
+        benchSnapshots();
+    }
+    if (selected("book")) {
+        benchBook();
+    }
+    if (selected("risk")) {
+        benchRisk();
+    }
+    if (selected("gateway")) {
+        benchGateway();
+    }
+    if (selected("logger")) {
+        benchLogger();
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "BenchUtil.h"
+#include "Logger.h"
+#include "Types.h"
+#include "tickRouter.cpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// End-to-end benchmark: synthetic tick batches go through TickRouter, the
+// candle shards and the OrderManager exactly as live batches do.
+//
+// Usage: pipelineBench [--instruments 2,100,1000,10000] [--rate ticks/s]
+//                      [--seconds N] [--batch N] [--shards N] [--async]
+//
+// Every instrument ticks once per second of exchange time, so candles close
+// and patterns fire as they would in a session. --rate 0 (default) sends as
+// fast as the pipeline accepts; otherwise batches are paced to that rate and
+// latency counts from the scheduled send time, so falling behind shows up.
+//
+// By default each batch is drained through the shards before the next one
+// (the replay path) and latency is tick-to-signal for the batch. --async
+// measures the live path instead: latency is the feed thread's cost per
+// batch, shards process concurrently and may drop ticks when they fall
+// behind.
+
+namespace {
+
+constexpr int64_t SESSION_OPEN = 1704080700; // 09:15 IST, 1 Jan 2024
+
+struct Options {
+    std::vector<uint32_t> instruments = { 2, 100, 1000, 10000 };
+    double rate = 0;
+    double seconds = 2;
+    uint32_t batch = 0; // 0: one websocket frame per 500 ticks, at most
+    int shards = 1;
+    bool async = false;
+};
+
+std::vector<uint32_t> parseList(const char* text) {
+    std::vector<uint32_t> values;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        values.push_back(static_cast<uint32_t>(std::stoul(item)));
+    }
+    return values;
+}
+
+void runOnce(const Options& options, uint32_t instruments) {
+    const uint32_t batchSize = options.batch
+                                   ? options.batch
+                                   : std::min<uint32_t>(instruments, 500);
+    auto& shards = CandleShards::getInstance();
+    auto& router = TickRouter::getInstance();
+    shards.configure(options.shards, WaitPolicy::Block);
+    router.setDeterministic(!options.async);
+    shards.start();
+
+    std::vector<kc::tick> batch(batchSize);
+    std::vector<double> prices(instruments);
+    for (uint32_t i = 0; i < instruments; ++i) {
+        prices[i] = 1000 + 10 * i;
+    }
+
+    bench::Samples latency;
+    const int64_t batchInterval =
+        options.rate > 0 ? static_cast<int64_t>(1e9 * batchSize / options.rate) : 0;
+    const int64_t start = bench::nowNanos();
+    const int64_t deadline = start + static_cast<int64_t>(options.seconds * 1e9);
+    uint64_t sent = 0, batches = 0;
+    uint32_t seed = 12345;
+    while (bench::nowNanos() < deadline) {
+        for (uint32_t k = 0; k < batchSize; ++k, ++sent) {
+            uint32_t instrument = sent % instruments;
+            seed = seed * 1664525u + 1013904223u;
+            prices[instrument] += ((seed >> 16) % 41 - 20) * 0.05;
+            kc::tick& tick = batch[k];
+            tick.instrumentToken = 1000000 + instrument;
+            tick.lastPrice = prices[instrument];
+            tick.timestamp = SESSION_OPEN + int64_t(sent / instruments);
+        }
+
+        // Live, bars also close on the clock, which follows the feed here
+        TradeClock::setSimulated(
+            (SESSION_OPEN + int64_t(sent / instruments)) * 1000000000LL);
+        int64_t sendAt = bench::nowNanos();
+        if (batchInterval > 0) {
+            int64_t scheduled = start + int64_t(batches) * batchInterval;
+            while (bench::nowNanos() < scheduled) {
+                std::this_thread::yield();
+            }
+            sendAt = scheduled;
+        }
+        router.route(batch);
+        latency.add(double(bench::nowNanos() - sendAt));
+        ++batches;
+    }
+    shards.waitUntilDrained();
+    const int64_t elapsed = bench::nowNanos() - start;
+
+    uint64_t dropped = 0;
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+        dropped += shards.shard(i).batchStats().dropped;
+    }
+    shards.stop();
+    router.setDeterministic(false);
+    TradeClock::setLive();
+
+    std::ostringstream params;
+    params << "\"instruments\":" << instruments << ",\"batch\":" << batchSize
+           << ",\"shards\":" << options.shards << ",\"rate\":" << options.rate
+           << ",\"mode\":\"" << (options.async ? "async" : "drain")
+           << "\",\"batches\":" << batches << ",\"dropped\":" << dropped;
+    // Throughput in ticks; latency percentiles are per batch
+    bench::report("pipeline.route", params.str(), sent, elapsed, latency);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (std::strcmp(arg, "--instruments") == 0) {
+            options.instruments = parseList(value), ++i;
+        } else if (std::strcmp(arg, "--rate") == 0) {
+            options.rate = std::atof(value), ++i;
+        } else if (std::strcmp(arg, "--seconds") == 0) {
+            options.seconds = std::atof(value), ++i;
+        } else if (std::strcmp(arg, "--batch") == 0) {
+            options.batch = static_cast<uint32_t>(std::atoi(value)), ++i;
+        } else if (std::strcmp(arg, "--shards") == 0) {
+            options.shards = std::max(1, std::atoi(value)), ++i;
+        } else if (std::strcmp(arg, "--async") == 0) {
+            options.async = true;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return 1;
+        }
+    }
+
+    Logger::getInstance().setLogLevel(Logger::ERROR);
+    for (uint32_t instruments : options.instruments) {
+        runOnce(options, std::max(1u, instruments));
+    }
+    return 0;
+}
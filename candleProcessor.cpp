@@ -1,170 +1,651 @@
+#include "HistoryLoader.h"
+#include "InstrumentMaster.h"
+#include "InstrumentRegistry.h"
+#include "LatencyTelemetry.h"
 #include "Logger.h"
+#include "SessionClock.h"
+#include "SpscRing.h"
+#include "StateStore.h"
+#include "TickBatch.h"
 #include "Types.h"
 #include "patternDetector.cpp"
 
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <map>
-#include <mutex>
 #include <unordered_map>
 
-// CandleProcessor handles tick data and creates 15-minute candles
+// Candle timeframes, in minutes, built when none are configured
+inline const std::vector<int> DEFAULT_TIMEFRAMES = { 1, 3, 5, 15, 60 };
+
+// CandleProcessor handles tick data and creates candles on every configured
+// timeframe for the instruments of one shard (see CandleShards). Ticks only
+// touch the forming bar of the finest timeframe; each closed bar is rolled up
+// into the coarser ones.
+//
+// Finest bars all end on the same boundaries, so they are closed together:
+// when the shard's clock reaches the next boundary, or a tick stamped at or
+// after it arrives first, every due bar of the shard closes in one pass.
+// Instruments without a tick in an interval of the session get a flat bar
+// at their last close, so their candles and signals keep to the clock.
+//
+// Instruments are addressed by InstrumentRegistry slot. A shard owns every
+// slot with slot % shardCount == shardId and stores it at index
+// slot / shardCount of its arrays.
 class CandleProcessor {
   private:
-    std::unordered_map<double, ScripData> scripDataMap;
-    std::unordered_map<double,
-        std::chrono::time_point<std::chrono::system_clock>>
-        lastCandleTimes;
-    std::mutex candleMutex;
-    std::condition_variable tickCondition;
-    std::vector<kc::tick> tickQueue;
+    // Batches, not ticks: a full onTicks callback is one entry
+    static constexpr std::size_t BATCH_RING_CAPACITY = 1024;
+    // Longest wait for ticks, so the close timer is checked at least this
+    // often
+    static constexpr int64_t MAX_WAIT_MS = 100;
+
+    // Flags per instrument in BarColumns::flags
+    static constexpr uint8_t SEEN = 1;     // Day range initialised
+    static constexpr uint8_t BAR_OPEN = 2; // Forming bar holds data
+    static constexpr uint8_t DIRTY = 4;    // Changed since the last checkpoint
+
+    // Forming bar of the finest timeframe and the day range, one array per
+    // field so the tick path touches a handful of cache lines
+    struct BarColumns {
+        std::vector<Price> open, high, low, close;
+        std::vector<int64_t> barStart, barEnd; // Epoch seconds
+        std::vector<Price> dayHigh, dayLow;
+        std::vector<uint8_t> flags;
+
+        void resize(std::size_t n) {
+            for (auto* column : { &open, &high, &low, &close, &dayHigh, &dayLow }) {
+                column->assign(n, 0);
+            }
+            barStart.assign(n, 0);
+            barEnd.assign(n, 0);
+            flags.assign(n, 0);
+        }
+    };
 
-    CandleProcessor() {} // Singleton pattern
+    // One candle series per configured interval, finest first. Only read and
+    // written when a bar closes.
+    struct Series {
+        ScripData data;
+        bool candleOpen = false; // data.candles.back() is still forming
+    };
+
+    std::vector<int64_t> intervals; // Seconds, ascending
+    BarColumns bars;
+    // Indicators updated on every tick, indexed like bars. Kept as one
+    // struct per instrument since a tick touches all of its fields.
+    std::vector<SessionIndicators> sessions;
+    std::vector<std::vector<Series>> history; // Indexed like bars
+    std::size_t used = 0; // Indices below this have been seen
+    SessionClock::Origin sessionOrigin;
+    // End of the current finest interval, epoch seconds; 0 until the first
+    // tick or clock reading
+    int64_t closeAt = 0;
+    // Close bars on the wall clock (TradeClock) too, closeDelayMs after each
+    // boundary, rather than only on the first tick past it
+    bool clockDriven = true;
+    int64_t closeDelayMs = 250;
+    // Filled by the ticker thread, drained by the tick processing thread.
+    // Every queued batch holds a reference, released once processed.
+    SpscRing<TickBatch*> batchRing{ BATCH_RING_CAPACITY };
+    // Batches queued by the ticker thread, and those whose patterns and
+    // checkpoint are done, published by the shard after both
+    std::atomic<uint64_t> queuedBatches{ 0 };
+    std::atomic<uint64_t> completedBatches{ 0 };
+    uint64_t reportedDrops = 0;
+    // Arrival stamp of the tick being processed, 0 outside processTicks
+    int64_t currentReceived = 0;
+    OrderManager& orders;
+    PatternDetector patternDetector;
+    // Checkpoint target, null unless attachState() was called
+    StateStore* state = nullptr;
+    std::vector<uint32_t> dirtySlots;
+    // Checkpoints left until both copies hold the current candle series
+    std::vector<uint8_t> seriesWrites;
+    // Closed candles come from history, see warmStart()
+    bool warming = false;
+    const int shardId;
+    const int shardCount;
 
   public:
-    static CandleProcessor& getInstance() {
-        static CandleProcessor instance;
-        return instance;
+    // Each timeframe must be a multiple of the finest one, others are dropped
+    explicit CandleProcessor(int shardId = 0, int shardCount = 1,
+        std::vector<int> timeframeMinutes = DEFAULT_TIMEFRAMES,
+        OrderManager& orders = OrderManager::getInstance())
+        : orders(orders), patternDetector(orders), shardId(shardId),
+          shardCount(shardCount) {
+        std::sort(timeframeMinutes.begin(), timeframeMinutes.end());
+        timeframeMinutes.erase(
+            std::unique(timeframeMinutes.begin(), timeframeMinutes.end()),
+            timeframeMinutes.end());
+        for (int minutes : timeframeMinutes) {
+            if (minutes <= 0 ||
+                (!intervals.empty() && (minutes * 60) % intervals[0] != 0)) {
+                Logger::getInstance().log(Logger::ERROR,
+                    "Ignoring candle timeframe ", minutes, "m");
+                continue;
+            }
+            intervals.push_back(minutes * 60);
+        }
+        if (intervals.empty()) {
+            intervals.push_back(15 * 60);
+        }
+
+        std::size_t capacity =
+            (InstrumentRegistry::MAX_INSTRUMENTS + shardCount - 1) / shardCount;
+        bars.resize(capacity);
+        sessions.assign(capacity, {});
+        history.resize(capacity);
+        seriesWrites.assign(capacity, 0);
+        patternDetector.resize(capacity, intervals.size());
     }
 
-    void addTicks(const std::vector<kc::tick>& ticks) {
-        // Logger::getInstance().log(
-        //   Logger::DEBUG, "addTicks: started ", ticks.size(), " ticks");
+    // Timeframes in seconds, finest first
+    const std::vector<int64_t>& timeframes() const { return intervals; }
 
-        std::lock_guard<std::mutex> lock(candleMutex);
-        tickQueue.insert(tickQueue.end(), ticks.begin(), ticks.end());
+    // Loads the saved state of this shard's slots and checkpoints them to
+    // store from now on. Must be called before the tick processing thread
+    // starts. Returns the number of instruments restored.
+    std::size_t attachState(StateStore& store) {
+        state = &store;
+        if (!store.wasRestored()) {
+            return 0;
+        }
+        std::size_t restored = 0;
+        for (uint32_t slot = shardId; slot < store.tokenCount();
+             slot += shardCount) {
+            const auto* record = store.candles(slot).read();
+            if (record == nullptr) {
+                continue;
+            }
+            const std::size_t i = slot / shardCount;
+            const auto& bar = record->bar;
+            bars.open[i] = bar.open;
+            bars.high[i] = bar.high;
+            bars.low[i] = bar.low;
+            bars.close[i] = bar.close;
+            bars.barStart[i] = bar.barStart;
+            bars.barEnd[i] = bar.barEnd;
+            bars.dayHigh[i] = bar.dayHigh;
+            bars.dayLow[i] = bar.dayLow;
+            bars.flags[i] = bar.flags & ~DIRTY;
+            sessions[i] = record->session;
+            used = std::max(used, i + 1);
+            if (record->seriesCount == intervals.size()) {
+                auto& series = seriesOf(slot);
+                for (std::size_t s = 0; s < series.size(); ++s) {
+                    series[s].data = record->series[s].data;
+                    series[s].candleOpen = record->series[s].candleOpen != 0;
+                }
+            }
+            seriesWrites[i] = 2;
+            ++restored;
+        }
+        return restored;
+    }
+
+    // Must be called before the tick processing thread starts
+    void setWaitPolicy(WaitPolicy policy) { batchRing.setWaitPolicy(policy); }
 
-        tickCondition.notify_one();
+    // Whether processTicks() closes bars on TradeClock as well as on tick
+    // times, and how long after a boundary, so ticks stamped just before it
+    // can still arrive. Deterministic replays close on tick times only.
+    // Must be called before the tick processing thread starts.
+    void setClockClose(bool enabled, int64_t delayMs) {
+        clockDriven = enabled;
+        closeDelayMs = std::max<int64_t>(0, delayMs);
+    }
+
+    SpscRingStats batchStats() const { return batchRing.stats(); }
+
+    // Called by the ticker thread only; notify() once the batch is queued.
+    // The shard takes over one reference of batch, the caller's if queued,
+    // and processes the ticks of its own slots. A lossless push waits for
+    // room instead of dropping the batch; false if it was dropped.
+    bool addBatch(TickBatch* batch, bool lossless = false) {
+        auto fill = [batch](TickBatch*& entry) { entry = batch; };
+        if (lossless) {
+            batchRing.pushWith(fill);
+        } else if (!batchRing.tryPushWith(fill)) {
+            return false;
+        }
+        queuedBatches.store(queuedBatches.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return true;
+    }
+
+    void notify() { batchRing.notify(); }
+
+    // True once every batch queued so far has been processed and the
+    // patterns it closed have armed their levels. Called by the ticker
+    // thread only.
+    bool idle() const {
+        return completedBatches.load(std::memory_order_acquire) ==
+               queuedBatches.load(std::memory_order_relaxed);
     }
 
     void processTicks() {
         // Logger::getInstance().log(Logger::DEBUG, "Process Ticks: started ");
-        std::vector<kc::tick> ticksToProcess;
-        {
-            std::unique_lock<std::mutex> lock(candleMutex);
-            tickCondition.wait(lock, [this] { return !tickQueue.empty(); });
-            ticksToProcess.swap(tickQueue);
+        auto& telemetry = LatencyTelemetry::getInstance();
+        const uint32_t shard = static_cast<uint32_t>(shardId);
+        const uint32_t shards = static_cast<uint32_t>(shardCount);
+        const auto& registry = InstrumentRegistry::getInstance();
+        auto processed = batchRing.drain([&](TickBatch* batch) {
+            telemetry.record(Stage::QueueWait, batch->received);
+            currentReceived = batch->received;
+            for (const CompactTick& tick : batch->ticks) {
+                if (tick.slot != InstrumentRegistry::INVALID_SLOT &&
+                    tick.slot % shards == shard &&
+                    !registry.isPriceOnly(tick.slot)) {
+                    updateCandle(tick.slot, tick.price, tick.time, tick.volume);
+                }
+            }
+            batch->release();
+        });
+        currentReceived = 0;
+        const bool closed = clockDriven && closeOnClock();
+        if (processed == 0 && !closed) {
+            batchRing.waitForData(std::chrono::milliseconds(waitMillis()));
+            return;
         }
+        flushPatterns();
+        saveState();
+        completedBatches.store(
+            completedBatches.load(std::memory_order_relaxed) + processed,
+            std::memory_order_release);
 
-        for (const auto& tick : ticksToProcess) {
-            updateCandle(tick.instrumentToken, tick.lastPrice);
+        auto stats = batchRing.stats();
+        if (stats.dropped != reportedDrops) {
+            LOG_FAST(ERROR, "Shard ", shardId,
+                ": batch ring full, dropped ",
+                stats.dropped - reportedDrops, " tick batches (total ",
+                stats.dropped, ", backpressure ", stats.backpressure, ")");
+            reportedDrops = stats.dropped;
         }
     }
 
-    void updateCandle(const double& instrumentToken, const double& lastPrice) {
+    // Runs pattern detection on every candle closed since the last call.
+    // processTicks() does this after each drained batch; callers driving
+    // updateCandle() directly call it after theirs.
+    void flushPatterns() { patternDetector.flush(); }
+
+    // tickTime is the exchange timestamp in epoch seconds. Candles are
+    // bucketed on it rather than on arrival time, so late or replayed ticks
+    // land in the same candle they would have live. volumeTraded is the
+    // tick's cumulative day volume, 0 where the feed has none.
+    void updateCandle(uint32_t slot, Price lastPrice, int64_t tickTime,
+        int64_t volumeTraded = 0) {
         // Logger::getInstance().log(Logger::DEBUG, "Update Candle : started ");
+        if (tickTime >= closeAt) {
+            // Past the boundary before the clock got there
+            closeDue(tickTime);
+        }
+
+        const std::size_t i = slot / shardCount;
+        uint8_t& flags = bars.flags[i];
+        markDirty(slot);
 
-        auto currentTime = std::chrono::system_clock::now();
         // Check if this instrument is being processed for the first time
-        if (lastCandleTimes.find(instrumentToken) == lastCandleTimes.end()) {
-            auto endTime = getCandleEndTime(currentTime);
-            Candle newCandle = { lastPrice, lastPrice, lastPrice, lastPrice,
-                "Green", currentTime, endTime };
-            ScripData scripData = { { newCandle }, lastPrice, lastPrice };
-            // scripDataMap[instrumentToken] = scripData;
-            scripDataMap.emplace(instrumentToken, scripData);
-            lastCandleTimes[instrumentToken] = currentTime;
-            return;
+        if (!(flags & SEEN)) {
+            bars.dayHigh[i] = lastPrice;
+            bars.dayLow[i] = lastPrice;
+            startSession(i, tickTime);
+            flags |= SEEN;
+            used = std::max(used, i + 1);
         }
 
-        auto& currentCandle = scripDataMap[instrumentToken].candles.back();
+        // Every open bar belongs to the current interval
+        const int64_t start = closeAt - intervals[0];
+        if (tickTime >= start) {
+            if (flags & BAR_OPEN) {
+                bars.high[i] = std::max(bars.high[i], lastPrice);
+                bars.low[i] = std::min(bars.low[i], lastPrice);
+                bars.close[i] = lastPrice;
+            } else {
+                bars.open[i] = bars.high[i] = bars.low[i] = bars.close[i] =
+                    lastPrice;
+                bars.barStart[i] = start;
+                bars.barEnd[i] = closeAt;
+                flags |= BAR_OPEN;
+            }
+        }
+        // else: a straggler for a candle that is already closed, it only
+        // counts towards the day range
 
-        if (currentCandle.endTime <= currentTime) {
-            finalizeCandle(instrumentToken, lastPrice);
-        } else {
+        bars.dayHigh[i] = std::max(bars.dayHigh[i], lastPrice);
+        bars.dayLow[i] = std::min(bars.dayLow[i], lastPrice);
+        sessions[i].onTick(lastPrice, volumeTraded, tickTime);
+    }
 
-            currentCandle.high = std::max(currentCandle.high, lastPrice);
-            currentCandle.low = std::min(currentCandle.low, lastPrice);
-            currentCandle.close = lastPrice;
+    // Closes every finest bar that ended by now, boundary by boundary. Only
+    // the last boundary before now is visited outside the session.
+    void closeDue(int64_t now) {
+        const int64_t interval = intervals[0];
+        const int64_t current =
+            SessionClock::bucketStart(now, sessionOrigin.of(now), interval);
+        if (closeAt == 0) {
+            closeAt = current;
         }
+        while (closeAt <= current) {
+            closeInterval(closeAt);
+            const int64_t origin = sessionOrigin.of(closeAt - 1);
+            closeAt += interval;
+            if (closeAt > origin + SessionClock::SESSION_LENGTH_SECONDS &&
+                closeAt < current) {
+                closeAt = current;
+            }
+        }
+    }
 
-        updateDayHighLow(instrumentToken, lastPrice);
+    // Closes the bars ending at or before boundary, and gives every
+    // instrument whose last bar ended one interval earlier a flat bar when
+    // boundary is within the session
+    void closeInterval(int64_t boundary) {
+        const int64_t interval = intervals[0];
+        const int64_t origin = sessionOrigin.of(boundary - 1);
+        const bool inSession = boundary > origin &&
+                               boundary <= origin + SessionClock::SESSION_LENGTH_SECONDS;
+        for (std::size_t i = 0; i < used; ++i) {
+            const uint32_t slot = static_cast<uint32_t>(i * shardCount + shardId);
+            if (bars.flags[i] & BAR_OPEN) {
+                if (bars.barEnd[i] <= boundary) {
+                    markDirty(slot);
+                    finalizeBar(slot);
+                }
+                continue;
+            }
+            if (!inSession || history[i].empty() ||
+                history[i][0].data.candles.empty() ||
+                history[i][0].data.candles.back().endTime != boundary - interval) {
+                continue;
+            }
+            markDirty(slot);
+            bars.open[i] = bars.high[i] = bars.low[i] = bars.close[i];
+            bars.barStart[i] = boundary - interval;
+            bars.barEnd[i] = boundary;
+            finalizeBar(slot, true);
+        }
     }
 
-    void finalizeCandle(
-        const double& instrumentToken, const double& lastPrice) {
-        auto& scripData = scripDataMap[instrumentToken];
-        Candle& lastCandle = scripData.candles.back();
-        lastCandle.close = lastPrice;
-        lastCandle.color =
-            (lastCandle.open < lastCandle.close) ? "Green" : "Red";
-        auto candleSize = (lastCandle.high - lastCandle.low);
-        lastCandle.bodyRatio =
-            (std::abs(lastCandle.open - lastCandle.close) / candleSize) * 100;
-        lastCandle.wickRatio = 100 - lastCandle.bodyRatio;
-        lastCandle.candleToIndexRatio = (candleSize / lastCandle.high) * 100;
+    // Closes the bars due by TradeClock less the close delay; returns
+    // whether any boundary was passed
+    bool closeOnClock() {
+        if (closeAt == 0 && used == 0) {
+            return false;
+        }
+        const int64_t nowMs = clockMillis() - closeDelayMs;
+        if (closeAt != 0 && nowMs < closeAt * 1000) {
+            return false;
+        }
+        closeDue(SessionClock::floorDiv(nowMs, 1000));
+        return true;
+    }
 
-        // Logging the candle
-        logCandle(instrumentToken, scripData);
+    // Until the close timer is next due, at most MAX_WAIT_MS
+    int64_t waitMillis() const {
+        if (!clockDriven || closeAt == 0) {
+            return MAX_WAIT_MS;
+        }
+        const int64_t due = closeAt * 1000 + closeDelayMs - clockMillis();
+        return std::min(MAX_WAIT_MS, std::max<int64_t>(1, due));
+    }
+
+    static int64_t clockMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            TradeClock::now().time_since_epoch())
+            .count();
+    }
 
-        if (!(scripData.DayHighReversalIdentified == true ||
-                scripData.DayLowReversalIdentified == true)) {
-            PatternDetector::getInstance().detectPattern(instrumentToken, scripData);
+    void markDirty(uint32_t slot) {
+        uint8_t& flags = bars.flags[slot / shardCount];
+        if (state != nullptr && !(flags & DIRTY)) {
+            flags |= DIRTY;
+            dirtySlots.push_back(slot);
         }
+    }
+
+    void startSession(std::size_t i, int64_t time) {
+        sessions[i].start(sessionOrigin.of(time),
+            int64_t(orders.strategy().openingRangeMinutes) * 60);
+    }
+
+    // Builds the candles and indicators of slot from closed minute bars,
+    // oldest first, before its ticks flow. Bars of today's session (by
+    // TradeClock) also set the day range, VWAP and opening range. The candles
+    // closed on the way are not evaluated for patterns or passed to the
+    // OrderManager, so history never places orders.
+    void warmStart(uint32_t slot, const HistoryLoader::Bar* history,
+        std::size_t count) {
+        const int64_t today = SessionClock::sessionOrigin(
+            std::chrono::duration_cast<std::chrono::seconds>(
+                TradeClock::now().time_since_epoch())
+                .count());
+        warming = true;
+        for (std::size_t b = 0; b < count; ++b) {
+            const auto& bar = history[b];
+            addBar(slot, bar, sessionOrigin.of(bar.start) == today);
+        }
+        warming = false;
+    }
 
-        OrderManager::getInstance().updateCandleData(instrumentToken, scripData);
+    // updateCandle() for a whole minute bar
+    void addBar(uint32_t slot, const HistoryLoader::Bar& bar, bool today) {
+        const std::size_t i = slot / shardCount;
+        uint8_t& flags = bars.flags[i];
+        markDirty(slot);
+        used = std::max(used, i + 1);
 
-        // Start a new candle
-        auto currentTime = std::chrono::system_clock::now();
-        Candle newCandle = { lastPrice, lastPrice, lastPrice, lastPrice,
-            "Green", currentTime, getCandleEndTime(currentTime) };
-        scripData.candles.push_back(newCandle);
+        if ((flags & BAR_OPEN) && bars.barEnd[i] <= bar.start) {
+            finalizeBar(slot);
+        }
+        if (today) {
+            if (!(flags & SEEN)) {
+                bars.dayHigh[i] = bar.high;
+                bars.dayLow[i] = bar.low;
+                startSession(i, bar.start);
+                flags |= SEEN;
+            }
+            bars.dayHigh[i] = std::max(bars.dayHigh[i], bar.high);
+            bars.dayLow[i] = std::min(bars.dayLow[i], bar.low);
+            sessions[i].onBar(
+                bar.high, bar.low, bar.close, bar.volume, bar.start);
+        } else {
+            sessions[i].barVolume += bar.volume;
+        }
 
-        // Keep only the last two candles
-        if (scripData.candles.size() > 2) {
-            scripData.candles.erase(scripData.candles.begin());
+        if (flags & BAR_OPEN) {
+            bars.high[i] = std::max(bars.high[i], bar.high);
+            bars.low[i] = std::min(bars.low[i], bar.low);
+            bars.close[i] = bar.close;
+        } else {
+            int64_t start = SessionClock::bucketStart(
+                bar.start, sessionOrigin.of(bar.start), intervals[0]);
+            bars.open[i] = bar.open;
+            bars.high[i] = bar.high;
+            bars.low[i] = bar.low;
+            bars.close[i] = bar.close;
+            bars.barStart[i] = start;
+            bars.barEnd[i] = start + intervals[0];
+            flags |= BAR_OPEN;
+        }
+        // Close the finest bar as soon as history completes it
+        if (bar.start + HistoryLoader::BAR_SECONDS >= bars.barEnd[i]) {
+            finalizeBar(slot);
         }
+    }
 
-        // Update the last candle time for this scrip
-        lastCandleTimes[instrumentToken] = currentTime;
+    // Moves the forming finest bar of slot, or a flat one filled in for an
+    // interval without ticks, into its candle history and closes it there.
+    // Kept out of line so updateCandle stays small.
+    __attribute__((noinline)) void finalizeBar(uint32_t slot, bool flat = false) {
+        const int64_t start = LatencyTelemetry::now();
+        const std::size_t i = slot / shardCount;
+        auto& series = seriesOf(slot);
+        patternDetector.settle(0, i);
+        series[0].data.candles.push_back({ bars.open[i], bars.high[i],
+            bars.low[i], bars.close[i], bars.barStart[i], bars.barEnd[i] });
+        if (flat) {
+            series[0].data.candles.back().color = CandleColor::Flat;
+        }
+        bars.flags[i] &= ~BAR_OPEN;
+        series[0].data.indicators.addVolume(sessions[i].barVolume);
+        sessions[i].barVolume = 0;
+        seriesWrites[i] = 2;
+        finalizeCandle(slot, series, 0);
+        if (!warming) {
+            LatencyTelemetry::getInstance().record(Stage::BarClose, start);
+        }
     }
 
-    void updateDayHighLow(
-        const double& instrumentToken, const double& lastPrice) {
-        auto& scripData = scripDataMap[instrumentToken];
-        scripData.dayHigh = std::max(scripData.dayHigh, lastPrice);
-        scripData.dayLow = std::min(scripData.dayLow, lastPrice);
+    // Checkpoints every slot touched since the last call. The forming bar
+    // goes into every checkpoint, the candle series only until both copies
+    // hold its latest state.
+    void saveState() {
+        if (state == nullptr) {
+            return;
+        }
+        for (uint32_t slot : dirtySlots) {
+            const std::size_t i = slot / shardCount;
+            bars.flags[i] &= ~DIRTY;
+            auto& checkpoint = state->candles(slot);
+            auto& record = checkpoint.next();
+            record.bar = { bars.open[i], bars.high[i], bars.low[i],
+                bars.close[i], bars.barStart[i], bars.barEnd[i],
+                bars.dayHigh[i], bars.dayLow[i], bars.flags[i] };
+            record.session = sessions[i];
+            if (seriesWrites[i] != 0) {
+                --seriesWrites[i];
+                const auto& series = history[i];
+                record.seriesCount = static_cast<uint32_t>(series.size());
+                for (std::size_t s = 0; s < series.size(); ++s) {
+                    record.series[s] = { series[s].data,
+                        static_cast<uint8_t>(series[s].candleOpen) };
+                }
+            }
+            checkpoint.publish();
+        }
+        dirtySlots.clear();
     }
 
-    std::chrono::system_clock::time_point getCandleEndTime(
-        const std::chrono::system_clock::time_point& tick_time) {
-        time_t raw_time = std::chrono::system_clock::to_time_t(tick_time);
-        std::tm* time_info = std::localtime(&raw_time);
+    // Closes the forming candle of series[index], stages it for pattern
+    // detection and, for the finest series, rolls it into every coarser one.
+    // A flat candle is only rolled up; indicators and patterns skip it.
+    void finalizeCandle(
+        uint32_t slot, std::vector<Series>& series, std::size_t index) {
+        auto& scripData = series[index].data;
+        Candle& lastCandle = scripData.candles.back();
+        scripData.dayHigh = bars.dayHigh[slot / shardCount];
+        scripData.dayLow = bars.dayLow[slot / shardCount];
+        const bool flat = lastCandle.color == CandleColor::Flat;
+        if (!flat) {
+            lastCandle.color = (lastCandle.open < lastCandle.close)
+                                   ? CandleColor::Green
+                                   : CandleColor::Red;
+        }
+        double candleSize = (lastCandle.high - lastCandle.low);
+        // A flat bar has neither body nor wick
+        if (candleSize > 0) {
+            lastCandle.bodyRatio =
+                (std::abs(lastCandle.open - lastCandle.close) / candleSize) * 100;
+            lastCandle.wickRatio = 100 - lastCandle.bodyRatio;
+            lastCandle.candleToIndexRatio = (candleSize / lastCandle.high) * 100;
+        } else {
+            lastCandle.bodyRatio = lastCandle.wickRatio = 0;
+            lastCandle.candleToIndexRatio = 0;
+        }
+        series[index].candleOpen = false;
+        const int64_t volume = flat ? 0
+                                    : scripData.indicators.close(lastCandle.high,
+                                          lastCandle.low, lastCandle.close);
+        scripData.indicators.setSession(
+            sessions[slot / shardCount], lastCandle.endTime);
+
+        if (!warming) {
+            // Logging the candle
+            logCandle(slot, scripData);
+
+            // Evaluated with every other close of this batch in flushPatterns(),
+            // which then hands it to the OrderManager
+            if (!flat) {
+                patternDetector.stage(
+                    index, slot, slot / shardCount, scripData, currentReceived);
+            }
+        }
 
-        // Align to nearest 15-minute interval
-        int minutes = time_info->tm_min;
-        int remainder = minutes % 15;
-        time_info->tm_min -= remainder;
-        time_info->tm_min += 15;
-        // Set seconds to zero
-        time_info->tm_sec = 0;
-        if (time_info->tm_min == 60) {
-            time_info->tm_min = 0;
-            time_info->tm_hour++;
+        if (index == 0) {
+            for (std::size_t i = 1; i < series.size(); ++i) {
+                rollUp(slot, series, i, lastCandle, volume);
+            }
         }
-        // std::cout << "End  time: " << std::put_time(time_info, "%Y-%m-%d
-        // %H:%M:%S") << std::endl;
-        return std::chrono::system_clock::from_time_t(std::mktime(time_info));
     }
 
-    void logCandle(const double& instrumentToken, ScripData& Data) {
-        std::string scripName {};
-        if (instrumentToken == 256265) {
-            scripName = "NIFTY";
-        } else if (instrumentToken == 260105) {
-            scripName = "BANK NIFTY";
+    // Merges a closed finest-series bar, which traded volume, into
+    // series[index]
+    void rollUp(uint32_t slot, std::vector<Series>& series, std::size_t index,
+        const Candle& bar, int64_t volume) {
+        auto& target = series[index];
+        if (target.candleOpen &&
+            target.data.candles.back().endTime <= bar.startTime) {
+            // No bar ended exactly on the boundary (the feed went quiet)
+            finalizeCandle(slot, series, index);
+        }
+        if (!target.candleOpen) {
+            patternDetector.settle(index, slot / shardCount);
+            int64_t start = SessionClock::bucketStart(bar.startTime,
+                sessionOrigin.of(bar.startTime), intervals[index]);
+            target.data.candles.push_back({ bar.open, bar.high, bar.low,
+                bar.close, start, start + intervals[index] });
+            // Flat until a bar that traded rolls into it
+            target.data.candles.back().color =
+                (bar.color == CandleColor::Flat) ? CandleColor::Flat
+                                                 : CandleColor::Green;
+            target.candleOpen = true;
+        } else {
+            Candle& candle = target.data.candles.back();
+            candle.high = std::max(candle.high, bar.high);
+            candle.low = std::min(candle.low, bar.low);
+            candle.close = bar.close;
+            if (bar.color != CandleColor::Flat) {
+                candle.color = CandleColor::Green;
+            }
         }
+        target.data.indicators.addVolume(volume);
+        if (bar.endTime >= target.data.candles.back().endTime) {
+            finalizeCandle(slot, series, index);
+        }
+    }
+
+    // Candle history of slot, created on its first bar close
+    std::vector<Series>& seriesOf(uint32_t slot) {
+        auto& series = history[slot / shardCount];
+        if (series.empty()) {
+            series.resize(intervals.size());
+            for (std::size_t i = 0; i < intervals.size(); ++i) {
+                series[i].data.intervalMinutes = intervals[i] / 60;
+            }
+        }
+        return series;
+    }
+
+    void logCandle(uint32_t slot, ScripData& Data) {
+        auto instrumentToken = InstrumentRegistry::getInstance().tokenOf(slot);
+        const char* scripName = InstrumentMaster::getInstance().symbolOf(slot);
 
         Candle& candleData = Data.candles.back();
-        Logger::getInstance().log(Logger::DEBUG,
-            "**************** \n** Scrip: ", scripName,
-            "\n** Open: ", candleData.open, "\t High: ", candleData.high,
-            "\n** Low: ", candleData.low, "\t Close: ", candleData.close,
-            "\n*** Candle Color: ", candleData.color,
-            "\n** Day High: ", Data.dayHigh, "\t Day Low: ", Data.dayLow,
+        LOG_FAST(DEBUG,
+            "**************** \n** Scrip: ", scripName, " (", instrumentToken,
+            ")\t Timeframe: ", Data.intervalMinutes, "m\t Shard: ", shardId,
+            "\n** Open: ", toRupees(candleData.open),
+            "\t High: ", toRupees(candleData.high),
+            "\n** Low: ", toRupees(candleData.low),
+            "\t Close: ", toRupees(candleData.close),
+            "\n*** Candle Color: ", colorName(candleData.color),
+            "\n** Day High: ", toRupees(Data.dayHigh),
+            "\t Day Low: ", toRupees(Data.dayLow),
             "\n bodyRatio: ", candleData.bodyRatio,
             "\t WickRatio: ", candleData.wickRatio,
             "\t candleToIndexRatio: ", candleData.candleToIndexRatio,
             "\n********************");
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,185 @@
+#include "InstrumentRegistry.h"
+#include "LatencyTelemetry.h"
+#include "Logger.h"
+#include "TickBatch.h"
+#include "Types.h"
+#include "WorkStealingPool.h"
+#include "candleProcessor.cpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// CandleShards partitions instruments by registry slot across a set of
+// CandleProcessor instances, each drained by its own worker thread. A slot
+// always maps to the same shard, so candle and pattern state never crosses
+// threads; orders and log lines from every shard go to the shared
+// OrderManager and Logger.
+class CandleShards {
+  private:
+    std::vector<std::unique_ptr<CandleProcessor>> shards;
+    std::vector<std::thread> workers;
+    std::vector<uint8_t> touched; // Shards with ticks in the current batch
+    std::atomic<bool> running{ false };
+    bool lossless = false;
+    bool clockClose = true;
+    int64_t closeDelayMs = 250;
+
+    CandleShards() { // Singleton pattern
+        configure(1, WaitPolicy::Block);
+        auto& telemetry = LatencyTelemetry::getInstance();
+        telemetry.setGauge("batch_ring_depth", [this] {
+            uint64_t depth = 0;
+            for (auto& shard : shards) {
+                depth = std::max<uint64_t>(depth, shard->batchStats().depth);
+            }
+            return depth;
+        });
+        telemetry.setGauge("batch_ring_dropped", [this] {
+            uint64_t dropped = 0;
+            for (auto& shard : shards) {
+                dropped += shard->batchStats().dropped;
+            }
+            return dropped;
+        });
+    }
+
+  public:
+    static CandleShards& getInstance() {
+        static CandleShards instance;
+        return instance;
+    }
+
+    ~CandleShards() { stop(); }
+
+    // Must be called before start()
+    void configure(int shardCount, WaitPolicy policy,
+        const std::vector<int>& timeframeMinutes = DEFAULT_TIMEFRAMES) {
+        if (shardCount < 1) {
+            shardCount = 1;
+        }
+        shards.clear();
+        for (int i = 0; i < shardCount; ++i) {
+            shards.push_back(
+                std::make_unique<CandleProcessor>(i, shardCount, timeframeMinutes));
+            shards.back()->setWaitPolicy(policy);
+            shards.back()->setClockClose(clockClose, closeDelayMs);
+        }
+        touched.assign(shards.size(), 0);
+    }
+
+    // Replays block the feed on a full ring rather than drop ticks
+    void setLossless(bool enabled) { lossless = enabled; }
+
+    // See CandleProcessor::setClockClose(). Must be called before start().
+    void setClockClose(bool enabled) {
+        clockClose = enabled;
+        for (auto& shard : shards) {
+            shard->setClockClose(clockClose, closeDelayMs);
+        }
+    }
+
+    void setCloseDelay(int64_t delayMs) {
+        closeDelayMs = delayMs;
+        setClockClose(clockClose);
+    }
+
+    std::size_t size() const { return shards.size(); }
+
+    // Timeframes in seconds, the same for every shard
+    const std::vector<int64_t>& timeframes() const {
+        return shards.front()->timeframes();
+    }
+
+    // Restores every shard from store and checkpoints to it from now on.
+    // Must be called before start(). Returns the instruments restored.
+    std::size_t attachState(StateStore& store) {
+        std::size_t restored = 0;
+        for (auto& shard : shards) {
+            restored += shard->attachState(store);
+        }
+        return restored;
+    }
+
+    // Builds every instrument's candles from its history, one thread per
+    // shard. Must be called before start().
+    void warmStart(const std::vector<HistoryLoader::InstrumentHistory>& histories) {
+        WorkStealingPool pool(shards.size());
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            pool.submit([this, &histories, i] {
+                for (const auto& history : histories) {
+                    if (history.ok && shardOf(history.slot) == i) {
+                        shards[i]->warmStart(
+                            history.slot, history.bars, history.count);
+                    }
+                }
+                shards[i]->saveState();
+            });
+        }
+        pool.run();
+    }
+
+    // Slots are handed out densely, so round-robin keeps shards balanced
+    std::size_t shardOf(uint32_t slot) const { return slot % shards.size(); }
+
+    void start() {
+        if (running.exchange(true)) {
+            return;
+        }
+        Logger::getInstance().log(
+            Logger::INFO, "Starting ", shards.size(), " candle shard(s)");
+        for (auto& shard : shards) {
+            workers.emplace_back([this, processor = shard.get()] {
+                while (running.load(std::memory_order_relaxed)) {
+                    processor->processTicks();
+                }
+            });
+        }
+    }
+
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // Called by the ticker thread only. Queues batch on every shard owning
+    // one of its candle-building slots, each holding its own reference;
+    // the caller keeps its reference.
+    void addBatch(TickBatch* batch) {
+        auto& registry = InstrumentRegistry::getInstance();
+        for (const CompactTick& tick : batch->ticks) {
+            if (tick.slot != InstrumentRegistry::INVALID_SLOT &&
+                !registry.isPriceOnly(tick.slot)) {
+                touched[shardOf(tick.slot)] = 1;
+            }
+        }
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            if (touched[i]) {
+                batch->retain();
+                if (!shards[i]->addBatch(batch, lossless)) {
+                    batch->release();
+                }
+                shards[i]->notify();
+                touched[i] = 0;
+            }
+        }
+    }
+
+    // Waits until every shard has processed all batches queued so far, so
+    // whatever the candles signalled is in place before the caller moves on
+    void waitUntilDrained() {
+        for (auto& shard : shards) {
+            while (!shard->idle()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    CandleProcessor& shard(std::size_t index) { return *shards[index]; }
+};
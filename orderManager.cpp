@@ -1,193 +1,566 @@
 
+#include "InstrumentRegistry.h"
+#include "LatencyTelemetry.h"
 #include "Logger.h"
+#include "OrderBook.h"
+#include "OrderGateway.h"
+#include "OptionChain.h"
+#include "PositionManager.h"
+#include "RiskEngine.h"
+#include "SeqLock.h"
+#include "SessionClock.h"
+#include "StateStore.h"
+#include "TickBatch.h"
+#include "TradeClock.h"
+#include "TriggerIndex.h"
 #include "Types.h"
+#include <algorithm>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
-// OrderManager handles placing buy and sell orders based on detected patterns
+// OrderManager handles placing buy and sell orders based on detected patterns.
+// Instruments are addressed by InstrumentRegistry slot.
+//
+// The live app uses the getInstance() singleton; backtests construct one per
+// run so runs never share state.
 class OrderManager {
   private:
+    // Orders of the position of a slot, as the gateway reported them
+    struct LegOrders {
+        uint64_t entryId = 0; // Buy neither filled nor rejected yet, 0 for none
+        int32_t held = 0;     // Contracts bought and no sell sent for
+        int32_t selling = 0;  // Sent to be sold, neither filled nor rejected
+        int32_t unsold = 0;   // Of sells rejected or dropped, to send again
+        uint32_t resends = 0; // Of the unsold contracts so far
+
+        // No contract of an earlier position is still bought or in flight
+        bool settled() const {
+            return entryId == 0 && held == 0 && selling == 0 && unsold == 0;
+        }
+    };
+
+    // Times a rejected or dropped sell is sent again before it is left to
+    // be squared off by hand
+    static constexpr uint32_t MAX_SELL_RESENDS = 3;
+
     std::mutex orderMutex;
-    std::unordered_map<double, std::thread> orderMonitoringThreads;
-    std::unordered_map<double, kc::tick> latestTickData;
+    // Armed entry levels, guarded by orderMutex
+    TriggerIndex triggerIndex{ InstrumentRegistry::MAX_INSTRUMENTS };
+    // Last traded price per slot, guarded by orderMutex
+    std::vector<Price> latestPrices =
+        std::vector<Price>(InstrumentRegistry::MAX_INSTRUMENTS, 0);
+    // Open positions and the trades closed so far, guarded by orderMutex
+    PositionManager positions{ InstrumentRegistry::MAX_INSTRUMENTS };
+    // Pre-trade checks and exposure of every entry, lock-free
+    RiskEngine riskEngine;
     std::condition_variable cv;
     bool stopMonitoring = false;
-    std::unordered_map<double, ScripData> OrderscripDataMap;
-    std::mutex scripDataMutex;
-    std::condition_variable sdMutex_cv;
-
-    OrderManager() {}
+    // Trade-timeframe candles per slot as of their last close, published
+    // by the slot's candle shard and read lock-free, see candleSnapshot()
+    std::unique_ptr<SeqLock<ScripData>[]> candleSnapshots{
+        new SeqLock<ScripData>[InstrumentRegistry::MAX_INSTRUMENTS]
+    };
+    StrategyParams params;
+    // Checkpoint target, null unless attachState() was called
+    StateStore* state = nullptr;
+    // Where entry and exit orders go, null to only track positions (as
+    // backtests do). Submitted under orderMutex.
+    OrderGateway* gateway = nullptr;
+    uint64_t nextOrderId = 1;
+    // Guarded by orderMutex, only kept while a gateway is attached
+    std::vector<LegOrders> legOrders =
+        std::vector<LegOrders>(InstrumentRegistry::MAX_INSTRUMENTS);
+    // Slots with unsold contracts, sent again with the next tick batch
+    std::vector<uint32_t> unsoldSlots, resending;
 
   public:
+    explicit OrderManager(const StrategyParams& params = {}) : params(params) {}
+
     static OrderManager& getInstance() {
         static OrderManager instance;
         return instance;
     }
-    ~OrderManager() {
-        /*         for (auto& thread : orderMonitoringThreads) {
-                   if (thread.joinable()) {
-                   thread.join();
+    ~OrderManager() {}
+
+    // Must be set before ticks flow
+    void setStrategy(const StrategyParams& strategy) { params = strategy; }
+    const StrategyParams& strategy() const { return params; }
+    // Must be set before ticks flow
+    void setRiskLimits(const RiskLimits& limits) { riskEngine.setLimits(limits); }
+    const RiskEngine& risk() const { return riskEngine; }
+
+    // Re-arms the levels and reopens the positions saved in store and
+    // checkpoints every change to them from now on. Must be called before
+    // ticks flow. Returns the number of instruments restored.
+    std::size_t attachState(StateStore& store) {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        state = &store;
+        if (!store.wasRestored()) {
+            return 0;
+        }
+        std::size_t restored = 0;
+        for (uint32_t slot = 0; slot < store.tokenCount(); ++slot) {
+            const auto* record = store.orders(slot).read();
+            if (record == nullptr) {
+                continue;
+            }
+            positions.open(slot, record->position);
+            if (record->position.open) {
+                riskEngine.reopened(slot, params.orderQuantity);
+                // Checkpointed as its buy went out, so taken as bought
+                legOrders[slot].held = params.orderQuantity;
             }
-        }*/
+            triggerIndex.disarm(slot);
+            for (uint32_t i = 0; i < record->triggerCount; ++i) {
+                triggerIndex.arm(slot, record->triggers[i]);
+            }
+            restored += record->position.open || record->triggerCount != 0;
+        }
+        return restored;
     }
 
-    void updateTickData(const std::vector<kc::tick>& ticks) {
+    // Sends an order for every entry and exit from now on; acks, fills and
+    // rejects are picked up with each tick batch. A position whose buy is
+    // rejected is dropped, an exit only sells the contracts bought and a
+    // rejected sell is sent again. Must be called before ticks flow.
+    void attachGateway(OrderGateway& orderGateway) {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        gateway = &orderGateway;
+    }
+
+    // Ticks with slot INVALID_SLOT are skipped; those of price-only slots
+    // only update the last price. received is the batch's
+    // LatencyTelemetry::now() stamp, 0 if unknown.
+    void updateTickData(
+        const std::vector<CompactTick>& ticks, int64_t received = 0) {
+        auto& telemetry = LatencyTelemetry::getInstance();
+        const int64_t start = LatencyTelemetry::now();
         //Logger::getInstance().log(Logger::DEBUG, " Inside updateTickData ");
 
-        std::lock_guard<std::mutex> lock(orderMutex);
-        for (const auto& tick : ticks) {
-            latestTickData[tick.instrumentToken] = tick;
-          //  Logger::getInstance().log(Logger::DEBUG, " Inside updateTickData  *", tick.lastPrice);
+        // Reused across batches, only ever touched by the ticker thread
+        static thread_local std::vector<FiredTrigger> fired;
+        fired.clear();
+        auto& registry = InstrumentRegistry::getInstance();
+        {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            if (gateway != nullptr) {
+                gateway->drainEvents(
+                    [this](const OrderEvent& event) { onOrderEvent(event); });
+                resendUnsold();
+            }
+            int64_t batchTime = 0;
+            for (const auto& tick : ticks) {
+                if (tick.slot == InstrumentRegistry::INVALID_SLOT) {
+                    continue;
+                }
+                latestPrices[tick.slot] = tick.price;
+                if (registry.isPriceOnly(tick.slot)) {
+                    continue;
+                }
+                batchTime = std::max(batchTime, tick.time);
+                checkExit(tick.slot, tick.price, tick.time);
+                if (!stopMonitoring) {
+                    const std::size_t before = fired.size();
+                    triggerIndex.collect(tick.slot, tick.price, tick.time, fired);
+                    // An entry on one side cancels the opposite level at
+                    // once, so a later tick of the batch cannot cross it
+                    if (fired.size() != before) {
+                        triggerIndex.disarm(tick.slot);
+                        fired.erase(fired.begin() + before + 1, fired.end());
+                    }
+                }
+              //  Logger::getInstance().log(Logger::DEBUG, " Inside updateTickData  *", tick.price);
+            }
+            // Time-based exits at the last price of their instrument
+            positions.advance(batchTime, [this, batchTime](uint32_t slot) {
+                logExit(slot, ExitReason::TimeLimit, latestPrices[slot]);
+                closePosition(slot, latestPrices[slot], batchTime,
+                    ExitReason::TimeLimit);
+            });
+            // Saved before the entry executes, so a restart never fires it
+            // a second time
+            for (const auto& entry : fired) {
+                saveState(entry.slot);
+            }
         }
-        //cv.notify_all();
+        for (const auto& entry : fired) {
+            executeEntry(entry);
+            if (received != 0) {
+                telemetry.record(Stage::TickToTrade, received);
+            }
+        }
+        telemetry.record(Stage::OrderTick, start);
     }
-    void updateCandleData(const double& instrumentToken, ScripData& scripData) {
-        std::lock_guard<std::mutex> lock(scripDataMutex);
-        OrderscripDataMap[instrumentToken] = scripData;
-        sdMutex_cv.notify_all();
+    // Called by the candle shard owning slot on every close, once patterns
+    // have been evaluated on it, so the snapshot carries its signals and
+    // reversal flags and follows the stop trailed on it
+    void updateCandleData(uint32_t slot, const ScripData& scripData) {
+        if (scripData.intervalMinutes != params.tradeIntervalMinutes) {
+            return;
+        }
+        trailStop(slot, scripData.candles.back());
+        candleSnapshots[slot].store(scripData);
     }
     void startOrderMonitoring(
-        const double& instrumentToken, const double signalCandleHigh, const double signalCandleLow) {
-        Logger::getInstance().log(
-            Logger::DEBUG, "startOrderMonitoring for ", instrumentToken);
+        uint32_t slot, const Price signalCandleHigh, const Price signalCandleLow) {
+        if (InstrumentRegistry::getInstance().isPriceOnly(slot)) {
+            return;
+        }
+        LOG_FAST(DEBUG, "startOrderMonitoring for ",
+            InstrumentRegistry::getInstance().tokenOf(slot));
 
-        orderMonitoringThreads[instrumentToken] = std::thread(
-            &OrderManager::monitorForTrade, this, instrumentToken, signalCandleHigh, signalCandleLow);
-    }
-    void monitorForTrade(
-        const double& instrumentToken, const double signalCandleHigh, const double signalCandleLow) {
-        bool tradeExecuted = false;
-        double stopLoss = 0;
         // TO DO Entry can be 0.1% above/below the signal candle.
-        while (!tradeExecuted && !stopMonitoring) {
-            double currentPrice = getCurrentPrice(instrumentToken);
-            if (currentPrice > signalCandleHigh) {
-                // Buy Call
-                //  placeBuyOrder(instrumentToken, currentPrice, "CE");
-                tradeExecuted = true;
-                stopLoss = signalCandleLow;
-                Logger::getInstance().log(Logger::DEBUG,
-                    "***** Trade Executed for CE ", instrumentToken, " at price ",
-                    currentPrice);
-
-                auto currentTime = std::chrono::system_clock::now();
-                time_t raw_time =
-                    std::chrono::system_clock::to_time_t(currentTime);
-                std::tm* time_info = std::localtime(&raw_time);
-
-                // Align to nearest 15-minute interval
-                int minutes = time_info->tm_min;
-                int remainder = minutes % 15;
-                auto minutesToWait = 30 - remainder;
-
-                startCallExitMonitoring(
-                    instrumentToken, stopLoss, currentTime, minutesToWait);
-
-            } else if (currentPrice < signalCandleLow) {
-                // Buy put
-                tradeExecuted = true;
-                stopLoss = signalCandleHigh;
-                Logger::getInstance().log(Logger::DEBUG,
-                    "***** Trade Executed for PE", instrumentToken, " at price ",
-                    currentPrice);
-                auto currentTime = std::chrono::system_clock::now();
-                time_t raw_time =
-                    std::chrono::system_clock::to_time_t(currentTime);
-                std::tm* time_info = std::localtime(&raw_time);
-
-                // Align to nearest 15-minute interval
-                int minutes = time_info->tm_min;
-                int remainder = minutes % 15;
-                auto minutesToWait = 30 - remainder;
-
-                startPutExitMonitoring(
-                    instrumentToken, stopLoss, currentTime, minutesToWait);
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        }
+        std::lock_guard<std::mutex> lock(orderMutex);
+        triggerIndex.disarm(slot);
+        triggerIndex.arm(slot,
+            { signalCandleHigh, Trigger::Above, Trigger::EnterCall,
+                signalCandleLow });
+        triggerIndex.arm(slot,
+            { signalCandleLow, Trigger::Below, Trigger::EnterPut,
+                signalCandleHigh });
+        saveState(slot);
     }
+    void executeEntry(const FiredTrigger& entry) {
+        uint32_t slot = entry.slot;
+        auto instrumentToken = InstrumentRegistry::getInstance().tokenOf(slot);
+        double currentPrice = toRupees(entry.price);
 
-    double getCurrentPrice(const double& instrumentToken) {
-        std::lock_guard<std::mutex> lock(orderMutex);
-        return latestTickData[instrumentToken].lastPrice;
-    }
-    ScripData& getCandleData(const double& instrumentToken) {
-        std::lock_guard<std::mutex> lock(scripDataMutex);
-        return OrderscripDataMap[instrumentToken];
-    }
-
-    void startCallExitMonitoring(const double& instrumentToken,
-        double& stopLoss,
-        std::chrono::_V2::system_clock::time_point& currentTime,
-        int& minsToWait) {
-        std::thread([this, instrumentToken, &stopLoss, currentTime,
-                        minsToWait] {
-            while (true) {
-                double currentPrice = getCurrentPrice(instrumentToken);
-
-                if (currentPrice < stopLoss) {
-                    // placeSellOrder(instrumentToken, currentPrice);
-                    Logger::getInstance().log(Logger::DEBUG,
-                        "***** Exit CE after SL/Target hit ", instrumentToken,
-                        " at price ", currentPrice);
-                    break;
-                }
+        // The stop trails once trailAfterCandles trade-timeframe candles,
+        // counted from the one the entry happened in, have closed
+        const int64_t interval = params.tradeIntervalMinutes * 60;
+        int64_t entryCandleStart = SessionClock::bucketStart(entry.tickTime,
+            SessionClock::sessionOrigin(entry.tickTime), interval);
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                auto duration =
-                    std::chrono::duration_cast<std::chrono::minutes>(
-                        std::chrono::system_clock::now() - currentTime);
-                if (duration.count() > minsToWait) {
-                    auto scripData = getCandleData(instrumentToken);
-                    Candle& currentCandle = scripData.candles.back();
-                    if (currentCandle.color == "Red") {
-                        stopLoss = currentCandle.low;
-                    }
-                }
+        if (!liquidEnough(entry)) {
+            return;
+        }
+        // Resolved before the lock, it is a few array reads
+        const Instrument* option = OptionChains::getInstance().resolve(
+            slot, entry.price, entry.trigger.action, params.optionStrikesAway);
+        const RiskCheck check = riskEngine.admit(
+            slot, entry.trigger.action, params.orderQuantity, entry.tickTime);
+        if (check != RiskCheck::Passed) {
+            LOG_FAST(DEBUG, "***** Entry refused for ", instrumentToken, ", ",
+                riskCheckName(check));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            if (positions[slot].open || !legOrders[slot].settled()) {
+                riskEngine.release(slot, params.orderQuantity);
+                LOG_FAST(DEBUG, "***** Entry ignored, position or its orders "
+                    "still open for ", instrumentToken);
+                return;
             }
-        }).detach();
-    }
-    void startPutExitMonitoring(const double& instrumentToken, double& stopLoss,
-        std::chrono::_V2::system_clock::time_point& currentTime,
-        int& minsToWait) {
-        std::thread([this, instrumentToken, &stopLoss, currentTime,
-                        minsToWait] {
-            while (true) {
-                double currentPrice = getCurrentPrice(instrumentToken);
-
-                if (currentPrice > stopLoss) {
-                    // placeSellOrder(instrumentToken, currentPrice);
-                    Logger::getInstance().log(Logger::DEBUG,
-                        "***** Exit PE after SL/Target hit ", instrumentToken,
-                        " at price ", currentPrice);
-                    break;
+            positions.open(slot, { true, entry.trigger.action, entry.price,
+                entry.trigger.stopLoss, entry.tickTime,
+                entryCandleStart + params.trailAfterCandles * interval,
+                timeExitOf(entry.tickTime),
+                (option != nullptr) ? option->token : 0,
+                (option != nullptr) ? lastPriceOf(option->token) : 0 });
+            saveState(slot);
+            if (gateway != nullptr) {
+                legOrders[slot].entryId = placeOrder(slot, OrderIntent::Buy,
+                    entry.trigger.action, entry.price, params.orderQuantity);
+                if (legOrders[slot].entryId == 0) {
+                    dropEntry(slot);
+                    return;
                 }
+            }
+        }
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                auto duration =
-                    std::chrono::duration_cast<std::chrono::minutes>(
-                        std::chrono::system_clock::now() - currentTime);
-                if (duration.count() > minsToWait) {
-                    auto scripData = getCandleData(instrumentToken);
-                    Candle& currentCandle = scripData.candles.back();
-                    if (currentCandle.color == "Green") {
-                        stopLoss = currentCandle.high;
-                    }
-                }
+        const char* contract = (option != nullptr) ? option->symbol : "";
+        if (entry.trigger.action == Trigger::EnterCall) {
+            // Buy Call
+            LOG_FAST(DEBUG,
+                "***** Trade Executed for CE ", instrumentToken, " at price ",
+                currentPrice, " ", contract);
+        } else {
+            // Buy put
+            LOG_FAST(DEBUG,
+                "***** Trade Executed for PE", instrumentToken, " at price ",
+                currentPrice, " ", contract);
+        }
+    }
+
+    Price getCurrentPrice(uint32_t slot) {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        return latestPrices[slot];
+    }
+    // Copies the trade-timeframe candles of slot as of their last close
+    // into out, consistent even while the shard publishes the next one.
+    // Returns the closes published so far, 0 (out untouched) before the
+    // first. Any thread may call it; it never takes a lock.
+    uint32_t candleSnapshot(uint32_t slot, ScripData& out) const {
+        return candleSnapshots[slot].load(out);
+    }
+
+    // Exits every open position at its last traded price, e.g. at the end of
+    // a backtest session
+    void closeOpenPositions(int64_t exitTime) {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        for (uint32_t slot = 0; slot < positions.size(); ++slot) {
+            if (positions[slot].open) {
+                closePosition(slot, latestPrices[slot], exitTime,
+                    ExitReason::SessionEnd);
             }
-        }).detach();
+        }
     }
 
-    void placeBuyOrder(const double& instrumentToken, const double& buyPrice,
-        const std::string& OpType) {
+    std::vector<ClosedTrade> closedTrades() {
         std::lock_guard<std::mutex> lock(orderMutex);
-        // Place buy order logic
+        return positions.closedTrades();
     }
 
-    void placeSellOrder(const double& instrumentToken, const double& sellPrice,
-        const std::string Optype) {
+  private:
+    // Exchange time of the time-based exit of a position entered at
+    // entryTime, 0 for none
+    int64_t timeExitOf(int64_t entryTime) const {
+        int64_t exitBy = 0;
+        if (params.maxHoldMinutes > 0) {
+            exitBy = entryTime + int64_t(params.maxHoldMinutes) * 60;
+        }
+        if (params.squareOffMinutes > 0) {
+            const int64_t squareOff = SessionClock::sessionOrigin(entryTime) +
+                                      int64_t(params.squareOffMinutes) * 60;
+            exitBy = (exitBy == 0) ? squareOff : std::min(exitBy, squareOff);
+        }
+        return exitBy;
+    }
+
+    void logExit(uint32_t slot, ExitReason reason, Price price) {
+        LOG_FAST(DEBUG, "***** Exit ",
+            (positions[slot].side == Trigger::EnterCall) ? "CE" : "PE",
+            " after ", exitReasonName(reason), " hit ",
+            InstrumentRegistry::getInstance().tokenOf(slot), " at price ",
+            toRupees(price));
+    }
+
+    // Whether the book of the entry's instrument, if it has one, is tight
+    // and balanced enough to enter on. A skipped entry stays disarmed.
+    bool liquidEnough(const FiredTrigger& entry) const {
+        L2Book book;
+        if (!OrderBooks::getInstance().read(entry.slot, book) || !book.twoSided()) {
+            return true;
+        }
+        const double against = (entry.trigger.action == Trigger::EnterCall)
+                                   ? -book.depthImbalance
+                                   : book.depthImbalance;
+        const bool wide =
+            params.maxSpreadBps > 0 && book.spreadBps() > params.maxSpreadBps;
+        if (!wide && against <= params.maxAdverseImbalance) {
+            return true;
+        }
+        LOG_FAST(DEBUG, "***** Entry skipped for ",
+            InstrumentRegistry::getInstance().tokenOf(entry.slot), ", spread ",
+            book.spreadBps(), " bps, imbalance ", book.depthImbalance);
+        return false;
+    }
+
+    // Stop-loss check on every tick; caller holds orderMutex
+    void checkExit(uint32_t slot, Price currentPrice, int64_t tickTime) {
+        if (positions.stopHit(slot, currentPrice)) {
+            logExit(slot, ExitReason::StopLoss, currentPrice);
+            closePosition(slot, currentPrice, tickTime, ExitReason::StopLoss);
+        }
+    }
+
+    // Trails the stop to the far end of a closed candle against the
+    // position; caller must not hold orderMutex
+    void trailStop(uint32_t slot, const Candle& candle) {
         std::lock_guard<std::mutex> lock(orderMutex);
-        // Place sell order logic (based on stop loss or target)
+        if (positions.trail(slot, candle)) {
+            saveState(slot);
+        }
+    }
+
+    // Caller holds orderMutex
+    void closePosition(
+        uint32_t slot, Price exitPrice, int64_t exitTime, ExitReason reason) {
+        const ClosedTrade& trade =
+            positions.close(slot, exitPrice, exitTime, reason);
+        // The daily loss is booked in what the option bought made, at its
+        // own prices; without a contract the underlying was traded
+        const Position& position = positions[slot];
+        int64_t pnl = trade.pnl();
+        if (position.contract != 0) {
+            const Price contractExit = lastPriceOf(position.contract);
+            pnl = 0;
+            if (position.contractEntry != 0 && contractExit != 0) {
+                pnl = int64_t(contractExit) - position.contractEntry;
+            } else {
+                LOG_FAST(ERROR, "No price to book the exit of option ",
+                    position.contract);
+            }
+        }
+        riskEngine.exited(
+            slot, params.orderQuantity, pnl * params.orderQuantity, exitTime);
+        saveState(slot);
+        // Contracts of an entry still in flight are sold once it fills
+        sellHeld(slot, exitPrice);
+    }
+
+    // Drops the open position of slot, whose buy was rejected or never
+    // sent, and gives back its exposure; caller holds orderMutex
+    void dropEntry(uint32_t slot) {
+        LOG_FAST(ERROR, "Entry for ",
+            InstrumentRegistry::getInstance().tokenOf(slot),
+            " not bought, position dropped");
+        positions.cancel(slot);
+        riskEngine.release(slot, params.orderQuantity);
+        saveState(slot);
+    }
+
+    // Sells the contracts bought for slot with the underlying at price;
+    // caller holds orderMutex
+    void sellHeld(uint32_t slot, Price price) {
+        auto& orders = legOrders[slot];
+        if (gateway == nullptr || orders.held == 0) {
+            return;
+        }
+        const int32_t quantity = orders.held;
+        orders.held = 0;
+        if (placeOrder(slot, OrderIntent::Sell, positions[slot].side, price,
+                quantity) != 0) {
+            orders.selling += quantity;
+        } else {
+            keepUnsold(slot, quantity);
+        }
+    }
+
+    // Caller holds orderMutex
+    void keepUnsold(uint32_t slot, int32_t quantity) {
+        auto& orders = legOrders[slot];
+        if (orders.unsold == 0) {
+            unsoldSlots.push_back(slot);
+        }
+        orders.unsold += quantity;
+        LOG_FAST(ERROR, "Sell of ", quantity, " for ",
+            InstrumentRegistry::getInstance().tokenOf(slot),
+            " failed, contracts still held");
+    }
+
+    // Sends the sells rejected or dropped since the last batch again, each
+    // at most MAX_SELL_RESENDS times. Contracts still unsold after that stay
+    // held, and their slot takes no entry, until squared off by hand.
+    // Caller holds orderMutex.
+    void resendUnsold() {
+        resending.swap(unsoldSlots);
+        for (uint32_t slot : resending) {
+            auto& orders = legOrders[slot];
+            if (orders.resends == MAX_SELL_RESENDS) {
+                LOG_FAST(ERROR, "Gave up selling ", orders.unsold, " for ",
+                    InstrumentRegistry::getInstance().tokenOf(slot),
+                    ", square off by hand");
+                continue;
+            }
+            ++orders.resends;
+            orders.held += orders.unsold;
+            orders.unsold = 0;
+            sellHeld(slot, latestPrices[slot]);
+        }
+        resending.clear();
+    }
+
+    // Caller holds orderMutex
+    void onOrderEvent(const OrderEvent& event) {
+        logOrderEvent(event);
+        auto& orders = legOrders[event.slot];
+        if (event.type == OrderEvent::Ack) {
+            return;
+        }
+        if (event.side == OrderIntent::Sell) {
+            orders.selling -= std::min(orders.selling, event.quantity);
+            if (event.type == OrderEvent::Reject) {
+                keepUnsold(event.slot, event.quantity);
+            } else if (orders.unsold == 0) {
+                orders.resends = 0;
+            }
+            return;
+        }
+        if (event.id != orders.entryId) {
+            return;
+        }
+        orders.entryId = 0;
+        if (event.type == OrderEvent::Fill) {
+            orders.held += event.quantity;
+            if (!positions[event.slot].open) {
+                // Exited before the fill came in
+                sellHeld(event.slot, latestPrices[event.slot]);
+            }
+        } else if (positions[event.slot].open) {
+            dropEntry(event.slot);
+        }
+    }
+
+    // Last traded price of token, 0 while unknown; caller holds orderMutex
+    Price lastPriceOf(uint32_t token) const {
+        const uint32_t tokenSlot = InstrumentRegistry::getInstance().slotOf(token);
+        return (tokenSlot == InstrumentRegistry::INVALID_SLOT)
+                   ? 0
+                   : latestPrices[tokenSlot];
+    }
+
+    // Buys or sells quantity of the leg option of slot through the gateway
+    // with the underlying at price: the position's contract, priced at its
+    // own last tick, or the underlying itself when no option chain covers
+    // it. Returns the order's id, 0 when it was dropped. Caller holds
+    // orderMutex.
+    uint64_t placeOrder(uint32_t slot, OrderIntent::Side side,
+        Trigger::Action leg, Price price, int32_t quantity) {
+        auto& registry = InstrumentRegistry::getInstance();
+        const uint32_t contract = positions[slot].contract;
+        Price orderPrice = price;
+        if (contract != 0) {
+            orderPrice = lastPriceOf(contract);
+            if (orderPrice == 0) {
+                LOG_FAST(ERROR, "No price yet for option ", contract);
+            }
+        }
+        OrderIntent order{ nextOrderId++, slot,
+            (contract != 0) ? contract : registry.tokenOf(slot), side, leg,
+            quantity, orderPrice, price, 0, 0 };
+        if (!gateway->submit(order)) {
+            LOG_FAST(ERROR, "Order queue full, dropped ",
+                (side == OrderIntent::Buy) ? "buy" : "sell", " order for ",
+                order.token);
+            return 0;
+        }
+        return order.id;
+    }
+
+    static void logOrderEvent(const OrderEvent& event) {
+        const char* side = (event.side == OrderIntent::Buy) ? "Buy" : "Sell";
+        switch (event.type) {
+        case OrderEvent::Ack:
+            LOG_FAST(DEBUG, "Order ", event.id, " ", side, " accepted as ",
+                event.exchangeId, " after ", event.attempts, " attempt(s)");
+            break;
+        case OrderEvent::Fill:
+            LOG_FAST(DEBUG, "Order ", event.id, " ", side, " filled ",
+                event.quantity, " at ", toRupees(event.fillPrice));
+            break;
+        case OrderEvent::Reject:
+            LOG_FAST(ERROR, "Order ", event.id, " ", side, " for ",
+                InstrumentRegistry::getInstance().tokenOf(event.slot),
+                " rejected after ", event.attempts, " attempt(s)");
+            break;
+        }
+    }
+
+    // Checkpoints the levels and position of slot; caller holds orderMutex
+    void saveState(uint32_t slot) {
+        if (state == nullptr) {
+            return;
+        }
+        auto& checkpoint = state->orders(slot);
+        auto& record = checkpoint.next();
+        record.position = positions[slot];
+        record.triggerCount = static_cast<uint32_t>(triggerIndex.copyArmed(
+            slot, record.triggers, StateStore::MAX_TRIGGERS));
+        checkpoint.publish();
     }
 };
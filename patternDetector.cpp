@@ -1,55 +1,131 @@
+#include "LatencyTelemetry.h"
 #include "Logger.h"
+#include "OrderBook.h"
+#include "PatternEngine.h"
 #include "Types.h"
 #include "orderManager.cpp"
 
-// PatternDetector identifies technical patterns based on 15-minute candles
+// PatternDetector identifies technical patterns on the candles of any timeframe.
+// Every CandleProcessor shard owns one, so it is only ever called from that
+// shard's thread and needs no locking. Signals on the strategy's trade
+// timeframe arm entries in the OrderManager it was built with.
+//
+// Closed candles are staged as they close and evaluated together by flush(),
+// one PatternEngine pass per timeframe across all instruments of the shard.
 class PatternDetector {
   private:
-    std::mutex patternMutex;
+    struct Pending {
+        uint32_t slot;
+        std::size_t row;
+        ScripData* data; // Lives in CandleProcessor's history, never moves
+        int64_t received; // LatencyTelemetry stamp of the closing tick, or 0
+        Price high, low; // As of the close
+    };
 
-    PatternDetector() {} // Singleton pattern
+    OrderManager& orders;
+    std::vector<PatternEngine> engines;      // One per timeframe
+    std::vector<std::vector<Pending>> pending; // Indexed like engines
 
   public:
-    static PatternDetector& getInstance() {
-        static PatternDetector instance;
-        return instance;
-    }
+    explicit PatternDetector(OrderManager& orders) : orders(orders) {}
 
-    void detectPattern(const double& instrumentToken, ScripData& scripData) {
-        std::lock_guard<std::mutex> lock(patternMutex);
-        if (scripData.candles.size() > 1) {
-            Candle& prevCandle = scripData.candles[scripData.candles.size() - 2];
-            Candle& currentCandle = scripData.candles.back();
+    // rows instruments on each of timeframes series
+    void resize(std::size_t rows, std::size_t timeframes) {
+        engines.assign(timeframes, PatternEngine(rows));
+        pending.assign(timeframes, {});
+    }
 
-            // if (currentCandle.bodyRatio >= 80) {
+    // Queues the candle that just closed in data for the next flush()
+    void stage(std::size_t timeframe, uint32_t slot, std::size_t row,
+        ScripData& data, int64_t received) {
+        auto& engine = engines[timeframe];
+        if (engine.isStaged(row)) {
+            // A second close before the flush, evaluate the first one now
+            evaluate(timeframe);
+        }
+        engine.stage(row, data);
+        pending[timeframe].push_back({ slot, row, &data, received,
+            data.candles.back().high, data.candles.back().low });
+    }
 
-            Logger::getInstance().log(Logger::DEBUG, " ### Inside Detect Pattern for :", instrumentToken);
-            auto candleToDayLowRatio =
-                (std::abs(currentCandle.low - scripData.dayLow) / scripData.dayLow) * 100;
-            auto candleToDayHighRatio =
-                (std::abs(currentCandle.high - scripData.dayHigh) / scripData.dayHigh) * 100;
+    // Evaluates the close staged for row, if any, before its series starts
+    // the next candle, so every staged candle is still the last one of its
+    // series when it is evaluated
+    void settle(std::size_t timeframe, std::size_t row) {
+        if (engines[timeframe].isStaged(row)) {
+            evaluate(timeframe);
+        }
+    }
 
-            if (prevCandle.color == "Red" && currentCandle.color == "Green" &&
-                ((currentCandle.low <= scripData.dayLow) ||
-                    (candleToDayLowRatio <= 0.1))) {
-                scripData.DayLowReversalIdentified = true;
+    // Evaluates every staged candle and acts on the signals
+    void flush() {
+        for (std::size_t timeframe = 0; timeframe < engines.size(); ++timeframe) {
+            if (!pending[timeframe].empty()) {
+                evaluate(timeframe);
             }
+        }
+    }
+
+  private:
+    void evaluate(std::size_t timeframe) {
+        auto& telemetry = LatencyTelemetry::getInstance();
+        const int64_t start = LatencyTelemetry::now();
+        auto& engine = engines[timeframe];
+        engine.evaluate(orders.strategy());
+        telemetry.record(Stage::PatternDetect, start);
 
-            if (prevCandle.color == "Green" && currentCandle.color == "Red" &&
-                ((currentCandle.high >= scripData.dayHigh) ||
-                    (candleToDayHighRatio <= 0.1))) {
-                scripData.DayHighReversalIdentified = true;
+        for (const auto& entry : pending[timeframe]) {
+            entry.data->signals = engine.mask(entry.row);
+            if (entry.data->signals != 0) {
+                onSignals(entry);
             }
+            // Published once its signals and reversal flags are set
+            orders.updateCandleData(entry.slot, *entry.data);
+        }
+        pending[timeframe].clear();
+    }
+
+    void onSignals(const Pending& entry) {
+        ScripData& scripData = *entry.data;
+        auto instrumentToken = InstrumentRegistry::getInstance().tokenOf(entry.slot);
+        for (uint32_t bits = scripData.signals; bits != 0; bits &= bits - 1) {
+            LOG_FAST(DEBUG, " ### Pattern ", patternName(bits & -bits),
+                " for :", instrumentToken, " (", scripData.intervalMinutes, "m)");
+        }
+
+        // The reversal strategy takes one signal per series
+        if (scripData.DayHighReversalIdentified ||
+            scripData.DayLowReversalIdentified) {
+            return;
+        }
+        if (scripData.signals & DAY_LOW_REVERSAL) {
+            scripData.DayLowReversalIdentified = true;
+        }
+        if (scripData.signals & DAY_HIGH_REVERSAL) {
+            scripData.DayHighReversalIdentified = true;
+        }
 
-            if (scripData.DayHighReversalIdentified ||
-                scripData.DayLowReversalIdentified) {
-                scripData.signalCandleHigh = (currentCandle.high > scripData.dayHigh) ? currentCandle.high : scripData.dayHigh;
-                scripData.signalCandleLow = (currentCandle.low < scripData.dayLow) ? currentCandle.low : scripData.dayLow;
-                Logger::getInstance().log(Logger::DEBUG, "***** Pattern Identified *****");
+        if (scripData.DayHighReversalIdentified ||
+            scripData.DayLowReversalIdentified) {
+            scripData.signalCandleHigh = (entry.high > scripData.dayHigh) ? entry.high : scripData.dayHigh;
+            scripData.signalCandleLow = (entry.low < scripData.dayLow) ? entry.low : scripData.dayLow;
+            LOG_FAST(DEBUG, "***** Pattern Identified on ",
+                scripData.intervalMinutes, "m *****");
+            L2Book book;
+            if (OrderBooks::getInstance().read(entry.slot, book) &&
+                book.twoSided()) {
+                LOG_FAST(DEBUG, " ### Book spread ", book.spreadBps(),
+                    " bps, microprice ", toRupees(book.microprice),
+                    ", imbalance ", book.depthImbalance);
+            }
 
-                OrderManager::getInstance().startOrderMonitoring(instrumentToken, scripData.signalCandleHigh,scripData.signalCandleLow);
+            if (scripData.intervalMinutes == orders.strategy().tradeIntervalMinutes) {
+                orders.startOrderMonitoring(entry.slot, scripData.signalCandleHigh,scripData.signalCandleLow);
+            }
+            if (entry.received != 0) {
+                LatencyTelemetry::getInstance().record(
+                    Stage::TickToSignal, entry.received);
             }
-            //}
         }
     }
 };
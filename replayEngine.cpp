@@ -0,0 +1,93 @@
+#include "Logger.h"
+#include "TickBatch.h"
+#include "TickJournal.h"
+#include "TradeClock.h"
+#include "Types.h"
+#include "tickRouter.cpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ReplayEngine feeds a tick journal back through TickRouter, batch by batch
+// as it was recorded. The trade clock follows the recorded receive times, so
+// the pipeline sees the session's clock however fast the replay runs.
+//
+// run() starts the candle shards in deterministic mode and stops them once
+// the journal is done; they must not be running when it is called.
+class ReplayEngine {
+  public:
+    // Sets the trade clock to the first recorded batch of the journal at
+    // path, so what is set up before run(), e.g. the state file session and
+    // a warm start, sees the replayed session's clock. Returns false,
+    // leaving the clock as it was, when the journal has no batch.
+    static bool startClock(const std::string& path) {
+        TickJournal::Reader reader;
+        const int64_t first = reader.open(path) ? reader.firstReceiveNanos() : 0;
+        if (first == 0) {
+            return false;
+        }
+        TradeClock::setSimulated(first);
+        return true;
+    }
+
+    // speed 0 replays as fast as the pipeline allows, otherwise the recorded
+    // gaps between batches are divided by speed (1 is real time)
+    bool run(const std::string& path, double speed = 0) {
+        TickJournal::Reader reader;
+        if (!reader.open(path)) {
+            Logger::getInstance().log(
+                Logger::ERROR, "Could not read tick journal ", path);
+            return false;
+        }
+
+        auto& router = TickRouter::getInstance();
+        auto& shards = CandleShards::getInstance();
+        router.setDeterministic(true);
+        shards.start();
+
+        uint64_t batches = 0, tickCount = 0;
+        int64_t firstNanos = 0;
+        auto wallStart = std::chrono::steady_clock::now();
+        reader.forEachBatch([&](const TickJournal::BatchHeader& batch,
+                                const TickJournal::JournalTick* recorded,
+                                uint32_t count) {
+            if (batches == 0) {
+                firstNanos = batch.receiveNanos;
+            }
+            if (speed > 0) {
+                std::this_thread::sleep_until(wallStart +
+                    std::chrono::nanoseconds(static_cast<int64_t>(
+                        (batch.receiveNanos - firstNanos) / speed)));
+            }
+            TradeClock::setSimulated(batch.receiveNanos);
+
+            TickBatch* routed = router.newBatch();
+            routed->ticks.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                CompactTick& tick = routed->ticks[i];
+                tick.token = recorded[i].instrumentToken;
+                tick.price = recorded[i].lastPrice;
+                tick.quantity = recorded[i].lastTradedQuantity;
+                tick.volume = recorded[i].volumeTraded;
+                tick.time = recorded[i].exchangeTime;
+            }
+            router.route(routed);
+
+            ++batches;
+            tickCount += count;
+        });
+
+        shards.stop();
+        router.setDeterministic(false);
+        TradeClock::setLive();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - wallStart);
+        Logger::getInstance().log(Logger::DEBUG, "Replayed ", batches,
+            " batches, ", tickCount, " ticks from ", path, " in ",
+            elapsed.count(), " ms");
+        return true;
+    }
+};
@@ -1,7 +1,12 @@
+#include "InstrumentMaster.h"
+#include "KiteOrderBackend.h"
 #include "Logger.h"
+#include "OptionChain.h"
+#include "SubscriptionManager.h"
 #include "Types.h"
-#include "candleProcessor.cpp"
+#include "replayEngine.cpp"
 #include <fstream>
+#include <functional>
 #include <limits>
 #include <map>
 #include <nlohmann/json.hpp>
@@ -13,14 +18,19 @@ class ScripDataReceiver {
     kc::kite* Kite;
     kc::ticker* Ticker;
     std::string accessToken;
-    std::thread tickProcessingThread;
+    // Places orders through Kite, if the session was given one
+    std::unique_ptr<OrderGateway> orderGateway;
 
   public:
-    ScripDataReceiver(const std::string& apiKey, const std::string& apiSecret, const std::string& reqToken) {
+    // makeGateway, if set, is handed the logged-in session to build the
+    // order gateway from before the ticker connects
+    ScripDataReceiver(const std::string& apiKey, const std::string& apiSecret,
+        const std::string& reqToken,
+        const std::function<std::unique_ptr<OrderGateway>(kc::kite&)>&
+            makeGateway = {}) {
         try {
             Logger::getInstance().log(Logger::DEBUG, "Application started.");
-                 //           tickProcessingThread =
-                //std::thread(&ScripDataReceiver::processTicksInThread, this);
+                 //           CandleShards::getInstance().start();
             ///*
                 Kite = new kc::kite(apiKey);
                 Ticker = new kc::ticker(apiKey, 5, true, 5);
@@ -38,8 +48,13 @@ class ScripDataReceiver {
 
                 Ticker->setAccessToken(accessToken);
 
-                tickProcessingThread =
-                std::thread(&ScripDataReceiver::processTicksInThread, this);
+                if (makeGateway) {
+                    orderGateway = makeGateway(*Kite);
+                    orderGateway->start();
+                    OrderManager::getInstance().attachGateway(*orderGateway);
+                }
+
+                CandleShards::getInstance().start();
 
                 Ticker->onConnect = [this](kc::ticker* ws) {
                     this->onConnect(ws); 
@@ -72,21 +87,23 @@ class ScripDataReceiver {
 
     ~ScripDataReceiver() {
         Ticker->stop();
-        tickProcessingThread.join();
+        CandleShards::getInstance().stop();
+        LatencyTelemetry::getInstance().stopReporter();
+        // Sends what is still queued while the session is alive
+        if (orderGateway) {
+            orderGateway->stop();
+        }
         delete Ticker;
         delete Kite;
     }
 
     void onConnect(kc::ticker* ws) {
         std::cout << "connected.. Subscribing now..\n";
-        ws->setMode("full", { 256265, 260105 });
+        SubscriptionManager::getInstance().subscribe(*ws);
     };
     void onTicks(kc::ticker*, const std::vector<kc::tick>& ticks) {
-        // Forward the ticks to CandleProcessor for candle formation
-        CandleProcessor::getInstance().addTicks(ticks);
-
-        // Forward the same ticks to OrderManager for trade monitoring
-        OrderManager::getInstance().updateTickData(ticks);
+        // Candle shards, OrderManager and the journal, if recording
+        TickRouter::getInstance().route(ticks);
     }
 
     void onError(kc::ticker* ws, int code, const std::string& message) {
@@ -101,17 +118,6 @@ class ScripDataReceiver {
         std::cout << "Closed the connection.. code: " << code
                   << " message: " << message << "\n";
     };
-
-    void processTicksInThread() {
-        while (true) {
-            // Process tick data every second in this thread
-            //Logger::getInstance().log(Logger::DEBUG, "processTicksInThread: started ");
-
-            CandleProcessor::getInstance().processTicks();
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(400));
-        }
-    }
 };
 
 // Function to generate random ticks
@@ -155,7 +161,217 @@ int main(int argc, char* argv[]) {
     auto apiSecret = jsonData[0]["api_secret"];
     auto reqToken = jsonData[0]["auth_token"];
 
-    ScripDataReceiver receiver(apiKey, apiSecret, reqToken);
+    // Optional: "spin", "yield" or "block" (default)
+    std::string waitPolicyName = jsonData[0].value("tick_wait_policy", "block");
+    WaitPolicy waitPolicy = WaitPolicy::Block;
+    if (waitPolicyName == "spin") {
+        waitPolicy = WaitPolicy::Spin;
+    } else if (waitPolicyName == "yield") {
+        waitPolicy = WaitPolicy::Yield;
+    }
+    // Optional: number of candle worker threads, instruments are split by token
+    int candleShards = jsonData[0].value("candle_shards", 1);
+    // Optional: candle timeframes in minutes, e.g. [1, 3, 5, 15, 60]
+    auto timeframes =
+        jsonData[0].value("candle_timeframes", DEFAULT_TIMEFRAMES);
+    CandleShards::getInstance().configure(
+        candleShards, waitPolicy, timeframes);
+    // Optional: milliseconds after each boundary at which bars close when
+    // no tick past it has arrived yet
+    CandleShards::getInstance().setCloseDelay(
+        jsonData[0].value("candle_close_delay_ms", 250));
+    // Optional strategy parameters, see StrategyParams
+    StrategyParams strategy;
+    strategy.tradeIntervalMinutes =
+        jsonData[0].value("trade_timeframe", strategy.tradeIntervalMinutes);
+    strategy.proximityPercent =
+        jsonData[0].value("proximity_percent", strategy.proximityPercent);
+    strategy.trailAfterCandles =
+        jsonData[0].value("trail_after_candles", strategy.trailAfterCandles);
+    strategy.orderQuantity =
+        jsonData[0].value("order_quantity", strategy.orderQuantity);
+    strategy.optionStrikesAway =
+        jsonData[0].value("option_strikes_away", strategy.optionStrikesAway);
+    strategy.maxHoldMinutes =
+        jsonData[0].value("max_hold_minutes", strategy.maxHoldMinutes);
+    strategy.squareOffMinutes =
+        jsonData[0].value("square_off_minutes", strategy.squareOffMinutes);
+    strategy.maxSpreadBps =
+        jsonData[0].value("max_spread_bps", strategy.maxSpreadBps);
+    strategy.maxAdverseImbalance = jsonData[0].value(
+        "max_adverse_imbalance", strategy.maxAdverseImbalance);
+    OrderManager::getInstance().setStrategy(strategy);
+    // Optional pre-trade limits, see RiskLimits; each is off while 0
+    RiskLimits risk;
+    risk.maxQuantityPerInstrument = jsonData[0].value(
+        "max_quantity_per_instrument", risk.maxQuantityPerInstrument);
+    risk.maxOpenPositions =
+        jsonData[0].value("max_open_positions", risk.maxOpenPositions);
+    risk.maxOrdersPerSecond =
+        jsonData[0].value("max_orders_per_second", risk.maxOrdersPerSecond);
+    risk.maxDailyLoss = jsonData[0].value("max_daily_loss", risk.maxDailyLoss);
+    risk.duplicateSeconds =
+        jsonData[0].value("duplicate_signal_seconds", risk.duplicateSeconds);
+    OrderManager::getInstance().setRiskLimits(risk);
+    LatencyTelemetry::getInstance().setGauge("risk_rejected", [] {
+        return OrderManager::getInstance().risk().rejectedTotal();
+    });
+
+    // Optional: Kite's instrument dump (the CSV of /instruments), for symbol
+    // names and lot sizes. Indexed once into "<path>.idx".
+    std::string instrumentsCsv = jsonData[0].value("instruments_csv", "");
+    if (!instrumentsCsv.empty() &&
+        !InstrumentMaster::getInstance().load(instrumentsCsv)) {
+        std::cerr << "Could not load instruments from " << instrumentsCsv
+                  << std::endl;
+    }
+    // Optional: instruments to stream, e.g.
+    //   [{"mode": "full", "tokens": [256265]},
+    //    {"mode": "ltp", "symbols": ["NFO:NIFTY24JAN21500CE"]}]
+    // Symbols need "instruments_csv". Defaults to NIFTY 50 and NIFTY BANK
+    // in full mode.
+    auto& subscriptions = SubscriptionManager::getInstance();
+    for (const auto& group : jsonData[0].value("subscriptions", nlohmann::json::array())) {
+        TickMode mode = TickMode::Full;
+        if (!parseTickMode(group.value("mode", "full"), mode)) {
+            std::cerr << "Unknown tick mode " << group.value("mode", "") << std::endl;
+            continue;
+        }
+        auto tokens = group.value("tokens", std::vector<uint32_t>{});
+        for (const std::string& symbol :
+            group.value("symbols", std::vector<std::string>{})) {
+            auto colon = symbol.find(':');
+            uint32_t token = (colon == std::string::npos)
+                                 ? 0
+                                 : InstrumentMaster::getInstance().tokenOf(
+                                       symbol.substr(0, colon), symbol.substr(colon + 1));
+            if (token == 0) {
+                std::cerr << "Unknown instrument " << symbol << std::endl;
+                continue;
+            }
+            tokens.push_back(token);
+        }
+        subscriptions.add(tokens, mode);
+    }
+    if (subscriptions.empty()) {
+        subscriptions.add({ 256265, 260105 }, TickMode::Full);
+    }
+
+    // Optional: replay a recorded tick journal instead of going live, see
+    // below. The state file and warm start then follow its recorded clock.
+    std::string replayJournal = jsonData[0].value("replay_journal", "");
+    if (!replayJournal.empty()) {
+        ReplayEngine::startClock(replayJournal);
+    }
+
+    // Optional: keep candle and order state in this file and resume from it
+    // after a restart
+    std::string stateFile = jsonData[0].value("state_file", "");
+    if (!stateFile.empty()) {
+        TickRouter::getInstance().attachState(stateFile);
+    }
+    // Optional: directory of minute bars ("<token>.csv" or "<token>.bin")
+    // to build today's candles and day range from when starting late.
+    // Skipped when the state file already resumed the session.
+    std::string historyDir = jsonData[0].value("history_dir", "");
+    if (!historyDir.empty() && !StateStore::getInstance().wasRestored()) {
+        TickRouter::getInstance().warmStart(historyDir);
+    }
+
+    // Option chains to trade on, built from "instruments_csv" once the
+    // state file has restored the registry. Optional: [{"underlying":
+    // 256265, "name": "NIFTY"}, ...], defaulting to NIFTY and BANKNIFTY.
+    // The nearest expiry of each is streamed in ltp mode, so entries find
+    // their contract and its price without a lookup. Contracts are only
+    // priced; they never build candles or arm entries of their own.
+    if (InstrumentMaster::getInstance().loaded()) {
+        auto chains = jsonData[0].value("option_chains",
+            nlohmann::json::parse(R"([{"underlying": 256265, "name": "NIFTY"},
+                {"underlying": 260105, "name": "BANKNIFTY"}])"));
+        const int32_t today = static_cast<int32_t>(SessionClock::floorDiv(
+            std::chrono::duration_cast<std::chrono::seconds>(
+                TradeClock::now().time_since_epoch())
+                    .count() +
+                SessionClock::IST_OFFSET_SECONDS,
+            SessionClock::DAY_SECONDS));
+        for (const auto& chain : chains) {
+            const std::string name = chain.value("name", "");
+            if (OptionChains::getInstance().build(InstrumentMaster::getInstance(),
+                    chain.value("underlying", 0u), name, today) == 0) {
+                std::cerr << "No options found for " << name << std::endl;
+            }
+        }
+        auto contracts = OptionChains::getInstance().nearestExpiryTokens();
+        auto& registry = InstrumentRegistry::getInstance();
+        for (uint32_t token : contracts) {
+            const uint32_t slot = registry.registerToken(token);
+            if (slot != InstrumentRegistry::INVALID_SLOT) {
+                registry.setPriceOnly(slot);
+            }
+        }
+        subscriptions.add(contracts, TickMode::Ltp);
+    }
+
+    // Optional: where entry and exit orders go, through the order gateway at
+    // most "order_rate_per_second" a second. "kite" places them on Kite once
+    // logged in (symbols come from "instruments_csv", "order_product" and
+    // "order_type" default to MIS and MARKET); "mock" sends them to a
+    // simulated exchange. Without one positions are only tracked.
+    const std::string orderBackend = jsonData[0].value("order_backend", "");
+    OrderGateway::Config gatewayConfig;
+    gatewayConfig.ordersPerSecond = jsonData[0].value(
+        "order_rate_per_second", gatewayConfig.ordersPerSecond);
+    gatewayConfig.burst = gatewayConfig.ordersPerSecond;
+    std::unique_ptr<OrderGateway> orderGateway;
+    std::function<std::unique_ptr<OrderGateway>(kc::kite&)> makeKiteGateway;
+    if (orderBackend == "mock") {
+        MockExchange::Config exchange;
+        exchange.latencyMicros = jsonData[0].value(
+            "mock_exchange_latency_us", exchange.latencyMicros);
+        orderGateway = std::make_unique<OrderGateway>(
+            std::make_unique<MockExchange>(exchange), gatewayConfig);
+        orderGateway->start();
+        OrderManager::getInstance().attachGateway(*orderGateway);
+    } else if (orderBackend == "kite") {
+        KiteOrderBackend::Config kiteOrders;
+        kiteOrders.product = jsonData[0].value("order_product", kiteOrders.product);
+        kiteOrders.orderType = jsonData[0].value("order_type", kiteOrders.orderType);
+        if (!InstrumentMaster::getInstance().loaded()) {
+            Logger::getInstance().log(Logger::ERROR,
+                "order_backend kite needs instruments_csv, every order will "
+                "be rejected");
+        }
+        makeKiteGateway = [kiteOrders, gatewayConfig](kc::kite& kite) {
+            return std::make_unique<OrderGateway>(
+                std::make_unique<KiteOrderBackend>(
+                    kite, InstrumentMaster::getInstance(), kiteOrders),
+                gatewayConfig);
+        };
+    } else {
+        Logger::getInstance().log(Logger::ERROR, "No order_backend configured",
+            orderBackend.empty() ? "" : " (unknown: " + orderBackend + ")",
+            ", no order will be placed");
+    }
+
+    // Optional: seconds between latency reports in the log, 0 disables them
+    LatencyTelemetry::getInstance().startReporter(std::chrono::seconds(
+        jsonData[0].value("latency_report_seconds", 60)));
+
+    // "replay_speed" 0 (default) runs as fast as possible, 1 is real time
+    if (!replayJournal.empty()) {
+        ReplayEngine replay;
+        bool replayed = replay.run(
+            replayJournal, jsonData[0].value("replay_speed", 0.0));
+        LatencyTelemetry::getInstance().stopReporter();
+        return replayed ? 0 : 1;
+    }
+    // Optional: record every live tick batch to this journal file
+    std::string recordJournal = jsonData[0].value("record_journal", "");
+    if (!recordJournal.empty()) {
+        TickRouter::getInstance().startRecording(recordJournal);
+    }
+
+    ScripDataReceiver receiver(apiKey, apiSecret, reqToken, makeKiteGateway);
     Logger::getInstance().setLogLevel(Logger::DEBUG);
   /*  
     auto j = 1;
@@ -164,8 +380,7 @@ int main(int argc, char* argv[]) {
         //Logger::getInstance().log(Logger::DEBUG, "J now : ", j);
         std::vector<kc::tick> tickmap = generateRandomTicks(2);
 
-        CandleProcessor::getInstance().addTicks(tickmap);
-        OrderManager::getInstance().updateTickData(tickmap);
+        receiver.onTicks(nullptr, tickmap);
 
         tickmap.clear();
         j++;
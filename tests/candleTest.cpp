@@ -0,0 +1,64 @@
+#include "InstrumentRegistry.h"
+#include "Logger.h"
+#include "Types.h"
+#include "candleProcessor.cpp"
+
+#include <cstdio>
+
+// Checks of the candle pipeline that the backtests cannot show, run by
+// ctest. Each case drives its own CandleProcessor and OrderManager.
+//
+// Usage: candleTest
+
+namespace {
+
+constexpr int64_t SESSION_OPEN = 1704080700; // 09:15 IST, 1 Jan 2024
+
+int failures = 0;
+
+void check(bool passed, const char* what) {
+    if (!passed) {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// A bar filled in for a quiet minute after a green bar at the day high
+// looks like a red one there, and must not fire a reversal
+void flatBarAfterGreenAtDayHigh() {
+    const uint32_t slot = InstrumentRegistry::getInstance().registerToken(1);
+    StrategyParams params;
+    params.tradeIntervalMinutes = 1;
+    OrderManager orders(params);
+    CandleProcessor candles(0, 1, { 1 }, orders);
+    auto tick = [&](int64_t second, double rupees) {
+        candles.updateCandle(slot, toPrice(rupees), SESSION_OPEN + second);
+        candles.flushPatterns();
+    };
+
+    tick(0, 100);
+    tick(30, 110); // Green, closes at the day high
+    tick(125, 109); // Quiet second minute gets a flat bar at 110
+    tick(150, 109.5);
+    tick(185, 109.5); // Publishes the third minute
+
+    ScripData snapshot;
+    check(orders.candleSnapshot(slot, snapshot) != 0,
+        "the third minute is published");
+    check(snapshot.candles.back().startTime == SESSION_OPEN + 120,
+        "the snapshot holds the third minute");
+    check(snapshot.signals == 0, "the bar after the flat one fires nothing");
+    check(!snapshot.DayHighReversalIdentified,
+        "the flat bar fires no day high reversal");
+}
+
+} // namespace
+
+int main() {
+    Logger::getInstance().setLogLevel(Logger::ERROR);
+    flatBarAfterGreenAtDayHigh();
+    if (failures == 0) {
+        std::puts("candleTest passed");
+    }
+    return failures != 0;
+}
@@ -0,0 +1,210 @@
+#include "HistoryLoader.h"
+#include "InstrumentRegistry.h"
+#include "LatencyTelemetry.h"
+#include "Logger.h"
+#include "OrderBook.h"
+#include "SessionClock.h"
+#include "StateStore.h"
+#include "SubscriptionManager.h"
+#include "TickBatch.h"
+#include "TickJournal.h"
+#include "TradeClock.h"
+#include "Types.h"
+#include "candleShards.cpp"
+
+#include <string>
+#include <vector>
+
+// TickRouter takes every tick batch, live from the ticker or from a journal
+// replay, and hands it to the candle shards and the OrderManager. Live
+// batches can be recorded to a journal on the way through.
+//
+// Each batch is converted once into CompactTicks in a pooled TickBatch that
+// the shards and the OrderManager all read in place, so no kc::tick is
+// copied past onTicks and a batch allocates nothing once the pool is warm.
+class TickRouter {
+  private:
+    TickBatchPool batches;
+    TickJournal::Writer journal;
+    bool deterministic = false;
+
+    TickRouter() {} // Singleton pattern
+
+  public:
+    static TickRouter& getInstance() {
+        static TickRouter instance;
+        return instance;
+    }
+
+    // Appends every batch routed from now on to the journal at path
+    bool startRecording(const std::string& path) {
+        if (!journal.open(path)) {
+            Logger::getInstance().log(
+                Logger::ERROR, "Could not open tick journal ", path);
+            return false;
+        }
+        Logger::getInstance().log(Logger::INFO, "Recording ticks to ", path);
+        return true;
+    }
+
+    void stopRecording() { journal.close(); }
+
+    // Resumes the candle shards and the OrderManager from the state file at
+    // path, if it holds today's session, and checkpoints them to it from
+    // then on.
+    // Must be called after the shards are configured and before any token
+    // is registered.
+    bool attachState(const std::string& path) {
+        auto start = std::chrono::steady_clock::now();
+        auto& store = StateStore::getInstance();
+        const int64_t session = SessionClock::sessionOrigin(
+            std::chrono::duration_cast<std::chrono::seconds>(
+                TradeClock::now().time_since_epoch())
+                .count());
+        if (!store.open(
+                path, CandleShards::getInstance().timeframes(), session)) {
+            Logger::getInstance().log(
+                Logger::ERROR, "Could not open state file ", path);
+            return false;
+        }
+        std::size_t instruments =
+            CandleShards::getInstance().attachState(store);
+        std::size_t orders = OrderManager::getInstance().attachState(store);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (store.wasRestored()) {
+            Logger::getInstance().log(Logger::DEBUG, "Restored ",
+                store.tokenCount(), " instruments (", instruments,
+                " with candles, ", orders, " with orders) from ", path, " in ",
+                elapsed.count(), " us");
+        } else {
+            Logger::getInstance().log(
+                Logger::DEBUG, "Starting with empty state in ", path);
+        }
+        return true;
+    }
+
+    // In deterministic mode no tick is dropped, bars close on tick times
+    // only and each batch is fully turned into candles and signals before
+    // the OrderManager sees its prices, so a replay gives the same result
+    // on every run. Must be called while the shards are stopped.
+    void setDeterministic(bool enabled) {
+        deterministic = enabled;
+        CandleShards::getInstance().setLossless(enabled);
+        CandleShards::getInstance().setClockClose(!enabled);
+    }
+
+    // Loads the minute bars in directory (see HistoryLoader.h) for every
+    // subscribed instrument that has a file there and builds their candles
+    // and day range from them. Must be called after the subscriptions are
+    // added and before the shards start.
+    bool warmStart(const std::string& directory) {
+        auto start = std::chrono::steady_clock::now();
+        auto& registry = InstrumentRegistry::getInstance();
+        auto& subscriptions = SubscriptionManager::getInstance();
+        auto histories = HistoryLoader::loadDirectory(directory,
+            std::chrono::duration_cast<std::chrono::seconds>(
+                TradeClock::now().time_since_epoch())
+                .count(),
+            [&subscriptions](uint32_t token) {
+                return subscriptions.contains(token);
+            });
+        auto& state = StateStore::getInstance();
+        if (state.isOpen()) {
+            state.saveTokens(registry);
+        }
+        std::size_t bars = 0;
+        for (const auto& history : histories) {
+            if (!history.ok) {
+                Logger::getInstance().log(
+                    Logger::ERROR, "Could not load history ", history.path);
+            }
+            bars += history.count;
+        }
+        CandleShards::getInstance().warmStart(histories);
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        Logger::getInstance().log(Logger::DEBUG, "Warmed up ",
+            histories.size(), " instruments from ", bars, " bars in ",
+            directory, " in ", elapsed.count(), " ms");
+        return !histories.empty();
+    }
+
+    // An empty batch stamped as arriving now, to fill and pass to route().
+    // Called by the ticker thread (or the replay driver) only.
+    TickBatch* newBatch() {
+        TickBatch* batch = batches.acquire();
+        batch->received = LatencyTelemetry::now();
+        return batch;
+    }
+
+    // Called by the ticker thread only. Ticks with market depth ("full"
+    // mode) also update their instrument's L2Book before anyone sees the
+    // batch.
+    void route(const std::vector<kc::tick>& ticks) {
+        TickBatch* batch = newBatch();
+        batch->ticks.resize(ticks.size());
+        for (std::size_t i = 0; i < ticks.size(); ++i) {
+            compact(ticks[i], batch->ticks[i]);
+        }
+        resolveSlots(batch);
+        auto& books = OrderBooks::getInstance();
+        for (std::size_t i = 0; i < ticks.size(); ++i) {
+            const auto& depth = ticks[i].marketDepth;
+            const uint32_t slot = batch->ticks[i].slot;
+            if ((!depth.buy.empty() || !depth.sell.empty()) &&
+                slot != InstrumentRegistry::INVALID_SLOT) {
+                books.update(slot, ticks[i], batch->ticks[i].time);
+            }
+        }
+        dispatch(batch);
+    }
+
+    // Routes a batch from newBatch() with every field but slot filled in,
+    // taking over its reference. Called by the ticker thread (or the replay
+    // driver) only.
+    void route(TickBatch* batch) {
+        resolveSlots(batch);
+        dispatch(batch);
+    }
+
+  private:
+    // Resolves every token to its slot once for all consumers. Tokens
+    // subscribed elsewhere are registered on their first tick.
+    void resolveSlots(TickBatch* batch) {
+        auto& registry = InstrumentRegistry::getInstance();
+        for (auto& tick : batch->ticks) {
+            tick.slot = registry.registerToken(tick.token);
+        }
+        auto& state = StateStore::getInstance();
+        if (state.isOpen()) {
+            state.saveTokens(registry);
+        }
+    }
+
+    void dispatch(TickBatch* batch) {
+        auto& telemetry = LatencyTelemetry::getInstance();
+        const int64_t received = batch->received;
+        telemetry.countTicks(batch->ticks.size());
+
+        if (journal.isOpen()) {
+            journal.append(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    TradeClock::now().time_since_epoch())
+                    .count(),
+                batch->ticks);
+        }
+
+        // Share the batch with the candle shards for candle formation
+        CandleShards::getInstance().addBatch(batch);
+        telemetry.record(Stage::FeedEnqueue, received);
+        if (deterministic) {
+            CandleShards::getInstance().waitUntilDrained();
+        }
+
+        // OrderManager reads the same ticks for trade monitoring
+        OrderManager::getInstance().updateTickData(batch->ticks, received);
+        batch->release();
+    }
+};